@@ -0,0 +1,191 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace bud {
+
+// a submitted frame, polled by the completion thread until the device is done with it
+class PendingJob {
+public:
+    virtual ~PendingJob() = default;
+
+    // must not block
+    virtual bool ready() = 0;
+    // readback and validation, runs on the completion thread
+    virtual void finish() = 0;
+};
+
+// for images without an asynchronous path, the work is done by the time it is queued
+class CompletedJob final : public PendingJob {
+public:
+    bool ready() override { return true; }
+    void finish() override {}
+};
+
+// forwards to the frameReady() and finishFrame() of a backend, which befriends it
+template<typename Owner, typename Frame>
+class FrameJob final : public PendingJob {
+public:
+    FrameJob(Owner& owner, const Frame& frame) : m_owner(owner), m_frame(frame) {}
+
+    bool ready() override { return m_owner.frameReady(m_frame); }
+    void finish() override { m_owner.finishFrame(m_frame); }
+
+private:
+    Owner& m_owner;
+    Frame m_frame;
+};
+
+// the one thread that polls CL events, GL syncs and Vulkan fences of all pending jobs and completes them,
+// and a second one that runs what may block after a completion, such as a resumed coroutine
+class CompletionThread {
+public:
+    using Callback = std::function<void(const std::exception_ptr&)>;
+
+    static CompletionThread& instance()
+    {
+        static CompletionThread thread;
+        return thread;
+    }
+
+    // done gets the exception of ready() or finish(), null on success, after the job has been destroyed;
+    // it runs on the completion thread and must not block: waiting there for a frame, as compute(), computeAsync(),
+    // tryEvict() or an evicting MemoryBudget::reserve() would, stalls every pending job, so hand such work to post()
+    void enqueue(std::unique_ptr<PendingJob> job, Callback done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queued.push_back({ std::move(job), std::move(done) });
+        }
+        m_condition.notify_one();
+    }
+
+    // runs continuation on the resume thread, in order, where it may block while the completion thread keeps going
+    void post(std::function<void()> continuation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_resumeMutex);
+            m_continuations.push_back(std::move(continuation));
+        }
+        m_resumeCondition.notify_one();
+    }
+
+    bool isCurrent() const
+    {
+        return std::this_thread::get_id() == m_thread.get_id();
+    }
+
+    // pending jobs complete first, then the continuations they posted run
+    ~CompletionThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+
+        {
+            std::lock_guard<std::mutex> lock(m_resumeMutex);
+            m_resumeStopping = true;
+        }
+        m_resumeCondition.notify_one();
+        m_resumeThread.join();
+    }
+
+    CompletionThread(const CompletionThread&) = delete;
+    CompletionThread& operator=(const CompletionThread&) = delete;
+
+private:
+    CompletionThread() : m_thread([this] { run(); }), m_resumeThread([this] { resume(); }) {}
+
+    struct Entry {
+        std::unique_ptr<PendingJob> job;
+        Callback done;
+    };
+
+    static constexpr std::chrono::microseconds minBackoff{ 20 };
+    static constexpr std::chrono::microseconds maxBackoff{ 1000 };
+
+    // sleeps while nothing is pending, otherwise polls with a backoff that resets whenever a job completes
+    void run()
+    {
+        std::vector<Entry> pending;
+        std::chrono::microseconds backoff = minBackoff;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                const auto woken = [this] { return m_stopping || !m_queued.empty(); };
+                if (pending.empty()) {
+                    m_condition.wait(lock, woken);
+                } else {
+                    m_condition.wait_for(lock, backoff, woken);
+                }
+                if (m_stopping && pending.empty() && m_queued.empty()) return;
+                std::move(m_queued.begin(), m_queued.end(), std::back_inserter(pending));
+                m_queued.clear();
+            }
+
+            bool progress = false;
+            for (size_t i = 0; i < pending.size();) {
+                std::exception_ptr error;
+                bool done = true;
+                try {
+                    done = pending[i].job->ready();
+                    if (done) pending[i].job->finish();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                if (!done) {
+                    ++i;
+                    continue;
+                }
+
+                Entry entry = std::move(pending[i]);
+                pending.erase(pending.begin() + i);
+                entry.job.reset();
+                entry.done(error);
+                progress = true;
+            }
+            backoff = progress ? minBackoff : std::min(backoff * 2, maxBackoff);
+        }
+    }
+
+    void resume()
+    {
+        for (;;) {
+            std::function<void()> continuation;
+            {
+                std::unique_lock<std::mutex> lock(m_resumeMutex);
+                m_resumeCondition.wait(lock, [this] { return m_resumeStopping || !m_continuations.empty(); });
+                if (m_continuations.empty()) return;
+                continuation = std::move(m_continuations.front());
+                m_continuations.pop_front();
+            }
+            continuation();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<Entry> m_queued;
+    bool m_stopping = false;
+    std::mutex m_resumeMutex;
+    std::condition_variable m_resumeCondition;
+    std::deque<std::function<void()>> m_continuations;
+    bool m_resumeStopping = false;
+    std::thread m_thread;
+    std::thread m_resumeThread;
+};
+
+}
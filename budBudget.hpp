@@ -0,0 +1,266 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <array>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <algorithm>
+#include <condition_variable>
+
+namespace bud {
+
+enum class Backend {
+    OpenCL,
+    OpenGL,
+    Vulkan
+};
+
+enum class Resource {
+    Image,
+    Staging
+};
+
+// a cached set of device objects that can be released now and recreated on its next use;
+// false leaves them, when the owner is in use on another thread or cannot be released from this one
+class Evictable {
+public:
+    virtual bool tryEvict() = 0;
+
+protected:
+    ~Evictable() = default;
+};
+
+// device memory accounting per backend and resource type, least recently used owners are evicted to stay under the limit
+class MemoryBudget {
+public:
+    static MemoryBudget& instance()
+    {
+        static MemoryBudget budget;
+        return budget;
+    }
+
+    // a cap below what the device reports, 0 removes it
+    void setLimit(const Backend backend, const size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_userLimits[index(backend)] = bytes;
+    }
+
+    // what the device reports as available to this process, queried by the backends
+    void setDeviceMemory(const Backend backend, const size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_deviceMemory[index(backend)] = bytes;
+    }
+
+    size_t limit(const Backend backend)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return limitLocked(backend);
+    }
+
+    size_t used(const Backend backend, const Resource resource)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_used[index(backend)][static_cast<size_t>(resource)];
+    }
+
+    size_t evictions()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_evictions;
+    }
+
+    // evicts other owners of the backend, oldest first, until bytes more fit; false if they still do not.
+    // the bytes are held for requester under the same lock as the check, add() turns them into what it allocated,
+    // so two setups at once cannot both pass and overshoot the limit together
+    bool reserve(const Backend backend, const size_t bytes, const Evictable* requester)
+    {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (totalLocked(backend) + bytes <= limitLocked(backend)) {
+                Reservation& reservation = m_reservations[requester];
+                reservation.backend = backend;
+                reservation.bytes += bytes;
+                m_reserved[index(backend)] += bytes;
+                return true;
+            }
+            lock.unlock();
+            if (!evictOne(backend, requester)) return false;
+        }
+    }
+
+    // drops what owner reserved and did not allocate, once its setup is done
+    void settle(const Evictable* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        releaseReservationLocked(owner);
+    }
+
+    // evicts the least recently used other owner of the backend that can be evicted now, used to retry a failed allocation
+    bool evictOne(const Backend backend, const Evictable* requester)
+    {
+        std::vector<const Evictable*> busy;
+        for (;;) {
+            Evictable* victim = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto found = std::find_if(m_recency.begin(), m_recency.end(), [&](const Evictable* owner) {
+                    return owner != requester && m_owners.at(owner).backend == backend && !evicting(owner) &&
+                           std::find(busy.begin(), busy.end(), owner) == busy.end();
+                });
+                if (found == m_recency.end()) return false;
+                victim = *found;
+                m_evicting.push_back(victim);
+            }
+            // outside the lock, the owner releases its objects and calls back into remove();
+            // until it is unpinned below retire() keeps the owner from being destroyed
+            bool evicted = false;
+            try {
+                evicted = victim->tryEvict();
+            } catch (...) {
+                unpin(victim);
+                throw;
+            }
+            if (evicted) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                removeLocked(victim);
+                ++m_evictions;
+            }
+            unpin(victim);
+            if (evicted) return true;
+            busy.push_back(victim);
+        }
+    }
+
+    // first thing in an owner's destructor: waits for an eviction of owner on another thread to finish,
+    // after that it is never picked again
+    void retire(const Evictable* owner)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_unpinned.wait(lock, [&] { return !evicting(owner); });
+        removeLocked(owner);
+    }
+
+    void add(const Backend backend, const Resource resource, const size_t bytes, Evictable* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_owners.find(owner);
+        if (found == m_owners.end()) {
+            m_recency.push_back(owner);
+            found = m_owners.emplace(owner, Owner{ backend, {}, std::prev(m_recency.end()) }).first;
+        }
+        found->second.bytes[static_cast<size_t>(resource)] += bytes;
+        m_used[index(backend)][static_cast<size_t>(resource)] += bytes;
+
+        auto reservation = m_reservations.find(owner);
+        if (reservation == m_reservations.end()) return;
+        const size_t taken = std::min(bytes, reservation->second.bytes);
+        reservation->second.bytes -= taken;
+        m_reserved[index(reservation->second.backend)] -= taken;
+    }
+
+    void remove(const Evictable* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removeLocked(owner);
+    }
+
+    // marks owner as the most recently used
+    void touch(const Evictable* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_owners.find(owner);
+        if (found == m_owners.end()) return;
+        m_recency.splice(m_recency.end(), m_recency, found->second.recency);
+    }
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+private:
+    MemoryBudget() = default;
+
+    static constexpr size_t backendCount = 3;
+    static constexpr size_t resourceCount = 2;
+
+    struct Owner {
+        Backend backend;
+        std::array<size_t, resourceCount> bytes;
+        std::list<Evictable*>::iterator recency;
+    };
+
+    struct Reservation {
+        Backend backend;
+        size_t bytes = 0;
+    };
+
+    static size_t index(const Backend backend) { return static_cast<size_t>(backend); }
+
+    size_t limitLocked(const Backend backend) const
+    {
+        const size_t device = m_deviceMemory[index(backend)] ? m_deviceMemory[index(backend)] : std::numeric_limits<size_t>::max();
+        const size_t user = m_userLimits[index(backend)] ? m_userLimits[index(backend)] : std::numeric_limits<size_t>::max();
+        return std::min(device, user);
+    }
+
+    void releaseReservationLocked(const Evictable* owner)
+    {
+        auto reservation = m_reservations.find(owner);
+        if (reservation == m_reservations.end()) return;
+        m_reserved[index(reservation->second.backend)] -= reservation->second.bytes;
+        m_reservations.erase(reservation);
+    }
+
+    void removeLocked(const Evictable* owner)
+    {
+        releaseReservationLocked(owner);
+        auto found = m_owners.find(owner);
+        if (found == m_owners.end()) return;
+        for (size_t resource = 0; resource < resourceCount; ++resource) {
+            m_used[index(found->second.backend)][resource] -= found->second.bytes[resource];
+        }
+        m_recency.erase(found->second.recency);
+        m_owners.erase(found);
+    }
+
+    void unpin(const Evictable* owner)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_evicting.erase(std::find(m_evicting.begin(), m_evicting.end(), owner));
+        }
+        m_unpinned.notify_all();
+    }
+
+    bool evicting(const Evictable* owner) const
+    {
+        return std::find(m_evicting.begin(), m_evicting.end(), owner) != m_evicting.end();
+    }
+
+    size_t totalLocked(const Backend backend) const
+    {
+        size_t total = m_reserved[index(backend)];
+        for (const size_t bytes : m_used[index(backend)]) total += bytes;
+        return total;
+    }
+
+    std::mutex m_mutex;
+    std::array<size_t, backendCount> m_userLimits{};
+    std::array<size_t, backendCount> m_deviceMemory{};
+    std::array<std::array<size_t, resourceCount>, backendCount> m_used{};
+    std::map<const Evictable*, Owner> m_owners;
+    // reserved by setups that have not allocated it yet
+    std::map<const Evictable*, Reservation> m_reservations;
+    std::array<size_t, backendCount> m_reserved{};
+    std::list<Evictable*> m_recency;
+    // owners whose evict() is running outside the lock
+    std::vector<const Evictable*> m_evicting;
+    std::condition_variable m_unpinned;
+    size_t m_evictions = 0;
+};
+
+}
@@ -0,0 +1,495 @@
+#pragma once
+
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+#include "budHalf.hpp"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace bud {
+
+// host pixel conversions for upload and readback; every kernel has a scalar reference in bud::scalar,
+// and the SSE2/SSSE3/AVX2/F16C paths are picked at compile time (-march=native enables them all)
+
+namespace scalar {
+
+inline void u8ToF32(const uint8_t* src, float* dst, const size_t count, const float scale)
+{
+    for (size_t i = 0; i < count; ++i) dst[i] = static_cast<float>(src[i]) * scale;
+}
+
+// rounds to nearest even like the vector path, NaN becomes 0
+inline void f32ToU8(const float* src, uint8_t* dst, const size_t count, const float scale)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const float value = src[i] * scale;
+        dst[i] = value > 0.0f ? static_cast<uint8_t>(std::nearbyint(std::min(value, 255.0f))) : 0;
+    }
+}
+
+inline void rgbToRgba(const uint8_t* src, uint8_t* dst, const size_t pixels, const uint8_t alpha)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        dst[4 * i + 0] = src[3 * i + 0];
+        dst[4 * i + 1] = src[3 * i + 1];
+        dst[4 * i + 2] = src[3 * i + 2];
+        dst[4 * i + 3] = alpha;
+    }
+}
+
+inline void rgbaToRgb(const uint8_t* src, uint8_t* dst, const size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        dst[3 * i + 0] = src[4 * i + 0];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2];
+    }
+}
+
+// swaps red and blue, so it turns BGRA into RGBA and back
+inline void swapRedBlue(const uint8_t* src, uint8_t* dst, const size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        const uint8_t red = src[4 * i + 2];
+        dst[4 * i + 1] = src[4 * i + 1];
+        dst[4 * i + 2] = src[4 * i + 0];
+        dst[4 * i + 3] = src[4 * i + 3];
+        dst[4 * i + 0] = red;
+    }
+}
+
+template<typename T>
+inline void planarToInterleaved(const T* const* planes, const int nrChannels, T* dst, const size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < nrChannels; ++c) dst[i * nrChannels + c] = planes[c][i];
+    }
+}
+
+template<typename T>
+inline void interleavedToPlanar(const T* src, const int nrChannels, T* const* planes, const size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < nrChannels; ++c) planes[c][i] = src[i * nrChannels + c];
+    }
+}
+
+inline void f32ToF16(const float* src, half* dst, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) dst[i] = half(src[i]);
+}
+
+inline void f16ToF32(const half* src, float* dst, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+}
+
+inline void u8ToF32(const uint8_t* src, float* dst, const size_t count, const float scale)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 factor = _mm256_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m256i value = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(value), factor));
+    }
+#elif defined(__SSE2__)
+    const __m128 factor = _mm_set1_ps(scale);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), factor));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), factor));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), factor));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), factor));
+    }
+#endif
+    scalar::u8ToF32(src + i, dst + i, count - i, scale);
+}
+
+// cvtps rounds to nearest even and the packs saturate; values from 2^31 up, +inf included, would convert to INT_MIN,
+// so they are clamped to 255 first, while min(255, NaN) keeps the NaN, which the signed pack turns into 0
+inline void f32ToU8(const float* src, uint8_t* dst, const size_t count, const float scale)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 factor = _mm_set1_ps(scale);
+    const __m128 limit = _mm_set1_ps(255.0f);
+    const auto convert = [&](const float* value) { return _mm_cvtps_epi32(_mm_min_ps(limit, _mm_mul_ps(_mm_loadu_ps(value), factor))); };
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = convert(src + i + 0);
+        const __m128i b = convert(src + i + 4);
+        const __m128i c = convert(src + i + 8);
+        const __m128i d = convert(src + i + 12);
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+    }
+#endif
+    scalar::f32ToU8(src + i, dst + i, count - i, scale);
+}
+
+inline void rgbToRgba(const uint8_t* src, uint8_t* dst, const size_t pixels, const uint8_t alpha)
+{
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // four pixels per 16 byte load, which reads two pixels ahead
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+    for (; i + 6 <= pixels; i += 4) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(bytes, shuffle), alphaMask));
+    }
+#endif
+    scalar::rgbToRgba(src + 3 * i, dst + 4 * i, pixels - i, alpha);
+}
+
+inline void rgbaToRgb(const uint8_t* src, uint8_t* dst, const size_t pixels)
+{
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // four pixels per 16 byte store, which writes four bytes past them
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; i + 6 <= pixels; i += 4) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(bytes, shuffle));
+    }
+#endif
+    scalar::rgbaToRgb(src + 4 * i, dst + 3 * i, pixels - i);
+}
+
+inline void swapRedBlue(const uint8_t* src, uint8_t* dst, const size_t pixels)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xff00ff00u));
+    const __m128i low = _mm_set1_epi32(0xff);
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(value, 16), low);
+        const __m128i blue = _mm_slli_epi32(_mm_and_si128(value, low), 16);
+        const __m128i swapped = _mm_or_si128(_mm_and_si128(value, greenAlpha), _mm_or_si128(red, blue));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), swapped);
+    }
+#endif
+    scalar::swapRedBlue(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+// four float planes are transposed four pixels at a time, four 8-bit planes unpacked sixteen at a time,
+// other layouts take the scalar loop
+template<typename T>
+inline void planarToInterleaved(const T* const* planes, const int nrChannels, T* dst, const size_t pixels)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    if constexpr (std::is_same<T, float>::value) {
+        if (nrChannels == 4) {
+            for (; i + 4 <= pixels; i += 4) {
+                __m128 r = _mm_loadu_ps(planes[0] + i);
+                __m128 g = _mm_loadu_ps(planes[1] + i);
+                __m128 b = _mm_loadu_ps(planes[2] + i);
+                __m128 a = _mm_loadu_ps(planes[3] + i);
+                _MM_TRANSPOSE4_PS(r, g, b, a);
+                _mm_storeu_ps(dst + 4 * i + 0, r);
+                _mm_storeu_ps(dst + 4 * i + 4, g);
+                _mm_storeu_ps(dst + 4 * i + 8, b);
+                _mm_storeu_ps(dst + 4 * i + 12, a);
+            }
+        }
+    } else if constexpr (std::is_same<T, uint8_t>::value) {
+        if (nrChannels == 4) {
+            for (; i + 16 <= pixels; i += 16) {
+                const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+                const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+                const __m128i rgLow = _mm_unpacklo_epi8(r, g);
+                const __m128i rgHigh = _mm_unpackhi_epi8(r, g);
+                const __m128i baLow = _mm_unpacklo_epi8(b, a);
+                const __m128i baHigh = _mm_unpackhi_epi8(b, a);
+                __m128i* out = reinterpret_cast<__m128i*>(dst + 4 * i);
+                _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rgLow, baLow));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLow, baLow));
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHigh, baHigh));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHigh, baHigh));
+            }
+        }
+    }
+#endif
+    // only the four channel paths leave a tail behind
+    if (i == 0) return scalar::planarToInterleaved(planes, nrChannels, dst, pixels);
+    const T* rest[4] = { planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i };
+    scalar::planarToInterleaved(rest, 4, dst + 4 * i, pixels - i);
+}
+
+template<typename T>
+inline void interleavedToPlanar(const T* src, const int nrChannels, T* const* planes, const size_t pixels)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    if constexpr (std::is_same<T, float>::value) {
+        if (nrChannels == 4) {
+            for (; i + 4 <= pixels; i += 4) {
+                __m128 p0 = _mm_loadu_ps(src + 4 * i + 0);
+                __m128 p1 = _mm_loadu_ps(src + 4 * i + 4);
+                __m128 p2 = _mm_loadu_ps(src + 4 * i + 8);
+                __m128 p3 = _mm_loadu_ps(src + 4 * i + 12);
+                _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+                _mm_storeu_ps(planes[0] + i, p0);
+                _mm_storeu_ps(planes[1] + i, p1);
+                _mm_storeu_ps(planes[2] + i, p2);
+                _mm_storeu_ps(planes[3] + i, p3);
+            }
+        }
+    }
+#endif
+    if (i == 0) return scalar::interleavedToPlanar(src, nrChannels, planes, pixels);
+    T* rest[4] = { planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i };
+    scalar::interleavedToPlanar(src + 4 * i, 4, rest, pixels - i);
+}
+
+// F16C rounds to nearest even as half(float) does
+inline void f32ToF16(const float* src, half* dst, const size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        const __m128i bits = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bits);
+    }
+#endif
+    scalar::f32ToF16(src + i, dst + i, count - i);
+}
+
+inline void f16ToF32(const half* src, float* dst, const size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+#endif
+    scalar::f16ToF32(src + i, dst + i, count - i);
+}
+
+// value preserving element conversions, what copyRect() and the readback use
+template<typename T, typename U>
+inline void convertPixels(const T* src, U* dst, const size_t count)
+{
+    std::copy(src, src + count, dst);
+}
+
+inline void convertPixels(const float* src, half* dst, const size_t count) { f32ToF16(src, dst, count); }
+inline void convertPixels(const half* src, float* dst, const size_t count) { f16ToF32(src, dst, count); }
+inline void convertPixels(const uint8_t* src, float* dst, const size_t count) { u8ToF32(src, dst, count, 1.0f); }
+inline void convertPixels(const float* src, uint8_t* dst, const size_t count) { f32ToU8(src, dst, count, 1.0f); }
+
+// below this many elements a conversion stays on the calling thread
+constexpr size_t parallelGrain = size_t(1) << 18;
+
+// the threads parallelFor() hands its ranges to, started once; never destroyed, so a conversion during static
+// destruction, such as a frame the completion thread still finishes, finds it
+class WorkerPool {
+public:
+    static WorkerPool& instance()
+    {
+        static WorkerPool* pool = new WorkerPool();
+        return *pool;
+    }
+
+    // the workers and the calling thread
+    size_t concurrency() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    // a worker that waited for its own pool could wait forever, so ranges split on a worker run inline
+    static bool onWorker()
+    {
+        return worker();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+private:
+    WorkerPool()
+    {
+        const size_t hardware = std::max(std::thread::hardware_concurrency(), 1u);
+        for (size_t i = 1; i < hardware; ++i) m_threads.emplace_back([this] { run(); });
+    }
+
+    static bool& worker()
+    {
+        thread_local bool isWorker = false;
+        return isWorker;
+    }
+
+    void run()
+    {
+        worker() = true;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return !m_tasks.empty(); });
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+};
+
+// splits [0, count) into one contiguous range per pool thread, fn(first, last) runs on each and the caller takes the first
+template<typename Function>
+inline void parallelFor(const size_t count, const size_t grain, Function fn)
+{
+    WorkerPool& pool = WorkerPool::instance();
+    const size_t threads = WorkerPool::onWorker() ? 1 : pool.concurrency();
+    const size_t ranges = std::min(threads, std::max<size_t>(count / std::max<size_t>(grain, 1), 1));
+    if (ranges == 1) {
+        fn(size_t(0), count);
+        return;
+    }
+
+    // notified under the lock, so the waiter cannot return and destroy it in between
+    struct Join {
+        std::mutex mutex;
+        std::condition_variable condition;
+        size_t remaining = 0;
+    } join;
+    const size_t step = (count + ranges - 1) / ranges;
+    for (size_t first = step; first < count; first += step) ++join.remaining;
+    for (size_t first = step; first < count; first += step) {
+        const size_t last = std::min(first + step, count);
+        pool.submit([&fn, &join, first, last] {
+            fn(first, last);
+            std::lock_guard<std::mutex> lock(join.mutex);
+            --join.remaining;
+            join.condition.notify_one();
+        });
+    }
+    fn(size_t(0), std::min(step, count));
+    std::unique_lock<std::mutex> lock(join.mutex);
+    join.condition.wait(lock, [&join] { return join.remaining == 0; });
+}
+
+// how pixels arrive from outside: 8-bit interleaved RGBA, RGB or BGRA, or one 8-bit plane per channel
+enum class PixelLayout {
+    RGBA8,
+    RGB8,
+    BGRA8,
+    Planar8
+};
+
+// a frame of 8-bit pixels waiting to be imported, Planar8 reads planes, the others src
+struct PixelImport {
+    PixelLayout layout = PixelLayout::RGBA8;
+    const uint8_t* src = nullptr;
+    const uint8_t* planes[4] = {};
+    float scale = 1.0f;
+};
+
+// pixels [first, last) of 8-bit pixels into a float RGBA frame on this thread, through a small scratch so each chunk
+// stays in cache between the two steps
+inline void importRange(const PixelLayout layout, const uint8_t* src, const uint8_t* const* planes, float* dst,
+                        const size_t first, const size_t last, const float scale)
+{
+    constexpr size_t chunk = 1024;
+    uint8_t rgba[4 * chunk];
+    for (size_t i = first; i < last; i += chunk) {
+        const size_t count = std::min(chunk, last - i);
+        const uint8_t* bytes = rgba;
+        if (layout == PixelLayout::RGBA8) {
+            bytes = src + 4 * i;
+        } else if (layout == PixelLayout::RGB8) {
+            rgbToRgba(src + 3 * i, rgba, count, 255);
+        } else if (layout == PixelLayout::BGRA8) {
+            swapRedBlue(src + 4 * i, rgba, count);
+        } else {
+            const uint8_t* offset[4] = { planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i };
+            planarToInterleaved(offset, 4, rgba, count);
+        }
+        u8ToF32(bytes, dst + 4 * i, 4 * count, scale);
+    }
+}
+
+// Planar8 reads planes[0..3], the others src
+inline void importPixels(const PixelLayout layout, const uint8_t* src, const uint8_t* const* planes, float* dst,
+                         const size_t pixels, const float scale = 1.0f)
+{
+    parallelFor(pixels, parallelGrain / 4, [&](const size_t first, const size_t last) {
+        importRange(layout, src, planes, dst, first, last, scale);
+    });
+}
+
+// the reverse on readback: an RGBA frame, float scaled by scale and narrowed or already 8-bit, laid out as layout;
+// Planar8 writes planes[0..3], the others dst
+template<typename T>
+inline void exportPixels(const PixelLayout layout, const T* src, uint8_t* dst, uint8_t* const* planes, const size_t pixels,
+                         const float scale = 1.0f)
+{
+    parallelFor(pixels, parallelGrain / 4, [&](const size_t first, const size_t last) {
+        constexpr size_t chunk = 1024;
+        uint8_t rgba[4 * chunk];
+        for (size_t i = first; i < last; i += chunk) {
+            const size_t count = std::min(chunk, last - i);
+            const uint8_t* bytes = nullptr;
+            if constexpr (std::is_same<T, uint8_t>::value) {
+                bytes = src + 4 * i;
+            } else {
+                // RGBA8 narrows straight into dst
+                uint8_t* narrowed = layout == PixelLayout::RGBA8 ? dst + 4 * i : rgba;
+                f32ToU8(src + 4 * i, narrowed, 4 * count, scale);
+                bytes = narrowed;
+            }
+
+            if (layout == PixelLayout::RGBA8) {
+                if (bytes != dst + 4 * i) std::memcpy(dst + 4 * i, bytes, 4 * count);
+            } else if (layout == PixelLayout::RGB8) {
+                rgbaToRgb(bytes, dst + 3 * i, count);
+            } else if (layout == PixelLayout::BGRA8) {
+                swapRedBlue(bytes, dst + 4 * i, count);
+            } else {
+                uint8_t* const offset[4] = { planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i };
+                interleavedToPlanar(bytes, 4, offset, count);
+            }
+        }
+    });
+}
+
+// bytes of pixels in layout
+inline size_t layoutBytes(const PixelLayout layout, const size_t pixels)
+{
+    return (layout == PixelLayout::RGB8 ? 3 : 4) * pixels;
+}
+
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <map>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <future>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include "budImage.hpp"
+#include "budRing.hpp"
+
+namespace bud {
+
+namespace ipc {
+
+// owns the images, and with them the device contexts and compiled kernels, of every job its clients send;
+// a short-lived client then pays for the IPC and the dispatch only
+class Daemon {
+public:
+    using Factory = std::function<std::unique_ptr<Imagef>(const Job&)>;
+
+    // at most maxImages images are kept, the least recently used goes first; validate checks every readback
+    // against the host reference on the serving thread, off by default so a job costs the IPC and the dispatch only
+    Daemon(const std::string& socketPath, Factory factory, const size_t maxImages = 16, const bool validate = false)
+        : m_socketPath(socketPath), m_factory(std::move(factory)), m_maxImages(std::max<size_t>(maxImages, 1)), m_validate(validate),
+          m_listener(-1), m_stopping(false), m_useCount(0)
+    {
+        const sockaddr_un address = socketAddress(m_socketPath);
+        unlink(m_socketPath.c_str());
+        m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        bool listening = m_listener >= 0 && bind(m_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+                         listen(m_listener, 16) == 0;
+        if (!listening && m_listener >= 0) close(m_listener);
+        checkErrorCode<bool, true>(listening, "failed to listen on socket!");
+    }
+
+    ~Daemon()
+    {
+        for (Connection& connection : m_connections) closeConnection(connection);
+        close(m_listener);
+        unlink(m_socketPath.c_str());
+    }
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    // serves on the calling thread until stop(), which keeps GLFW windows on the main thread;
+    // the jobs found in one pass are all in flight together and finished before the next poll
+    void run()
+    {
+        while (!m_stopping.load(std::memory_order_relaxed)) {
+            std::vector<pollfd> descriptors{ { m_listener, POLLIN, 0 } };
+            for (const Connection& connection : m_connections) {
+                descriptors.push_back({ connection.socket, POLLIN, 0 });
+                descriptors.push_back({ connection.doorbell, POLLIN, 0 });
+            }
+            if (poll(descriptors.data(), descriptors.size(), 100) < 0) continue;
+
+            for (size_t i = 0; i < m_connections.size(); ++i) {
+                uint64_t rings;
+                if (descriptors[2 + 2 * i].revents & POLLIN) static_cast<void>(read(m_connections[i].doorbell, &rings, sizeof(rings)));
+                startJobs(m_connections[i]);
+            }
+            finishJobs();
+
+            for (size_t i = m_connections.size(); i-- > 0;) {
+                if (!peerClosed(m_connections[i].socket)) continue;
+                closeConnection(m_connections[i]);
+                m_connections.erase(m_connections.begin() + i);
+            }
+            if (descriptors[0].revents & POLLIN) acceptClients();
+        }
+    }
+
+    // safe from a signal handler
+    void stop() { m_stopping.store(true, std::memory_order_relaxed); }
+
+private:
+    struct Connection {
+        int socket;
+        int doorbell;
+        std::unique_ptr<SharedRing> ring;
+        uint32_t next;
+    };
+
+    struct Running {
+        SlotHeader* slot;
+        Imagef* image;
+        std::future<void> frame;
+    };
+
+    using ImageKey = std::array<int, 8>;
+
+    struct CachedImage {
+        std::unique_ptr<Imagef> image;
+        uint64_t lastUsed;
+    };
+
+    // each client sends its ring and doorbell right after connecting
+    void acceptClients()
+    {
+        for (;;) {
+            const int socket = accept4(m_listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (socket < 0) return;
+            const std::array<int, 2> fds = receiveFds(socket);
+            if (fds[0] < 0) {
+                close(socket);
+                continue;
+            }
+            try {
+                m_connections.push_back({ socket, fds[1], std::make_unique<SharedRing>(fds[0]), 0 });
+            } catch (const std::exception&) {
+                close(fds[1]);
+                close(socket);
+            }
+        }
+    }
+
+    void closeConnection(Connection& connection)
+    {
+        close(connection.socket);
+        close(connection.doorbell);
+        connection.ring.reset();
+    }
+
+    // submitted slots in ring order; the job is copied out of shared memory before it is checked
+    void startJobs(Connection& connection)
+    {
+        SharedRing& ring = *connection.ring;
+        for (uint32_t i = 0; i < ring.slotCount(); ++i) {
+            SlotHeader& slot = ring.slot(connection.next);
+            if (slot.state.load(std::memory_order_acquire) != static_cast<uint32_t>(SlotState::Submitted)) return;
+            const Job job = slot.job;
+            try {
+                startJob(ring, connection.next, job);
+            } catch (const std::exception& e) {
+                completeJob(slot, e.what());
+            }
+            connection.next = (connection.next + 1) % ring.slotCount();
+        }
+    }
+
+    void startJob(SharedRing& ring, const uint32_t index, const Job& job)
+    {
+        // every backend allocates and transfers RGBA only, so other channel counts never reach them
+        checkErrorCode<int, 4>(job.nrChannels, "failed to start job, only 4 channels are supported!");
+        bool valid = job.width > 0 && job.height > 0 &&
+                     static_cast<size_t>(job.width) * job.height * job.nrChannels * sizeof(float) <= ring.inputBytes() &&
+                     job.resize.width >= 0 && job.resize.height >= 0 &&
+                     job.resize.filter >= Filter::None && job.resize.filter <= Filter::Triangle &&
+                     job.resize.format >= Format::RGBA32F && job.resize.format <= Format::RGBA16F;
+        checkErrorCode<bool, true>(valid, "failed to start job, bad size!");
+
+        // checked before an image is created for the job, so a rejected job leaves nothing behind
+        const Resize resize = normalizeResize(job.resize, job.width, job.height);
+        const size_t outputBytes = static_cast<size_t>(resize.width) * resize.height * job.nrChannels * channelSize(resize.format);
+        checkErrorCode<bool, true>(outputBytes <= ring.outputBytes(), "failed to start job, output does not fit!");
+
+        Imagef& image = cachedImage(job);
+
+        // the one host copy, m_data stays the image's own so later frames can be diffed against it
+        std::memcpy(image.m_data.data(), ring.input(index), image.m_data.size() * sizeof(float));
+        image.setOutput(ring.output(index), outputBytes);
+        SlotHeader& slot = ring.slot(index);
+        slot.outputBytes = outputBytes;
+        m_running.push_back({ &slot, &image, image.computeAsync() });
+    }
+
+    void finishJobs()
+    {
+        for (Running& running : m_running) finishJob(running);
+        m_running.clear();
+    }
+
+    void finishJob(Running& running)
+    {
+        std::string error;
+        try {
+            running.frame.get();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        running.image->setOutput(nullptr, 0);
+        completeJob(*running.slot, error);
+    }
+
+    void completeJob(SlotHeader& slot, const std::string& error)
+    {
+        const size_t length = std::min(error.size(), sizeof(slot.error) - 1);
+        std::memcpy(slot.error, error.c_str(), length);
+        slot.error[length] = '\0';
+        const SlotState state = error.empty() ? SlotState::Done : SlotState::Failed;
+        slot.state.store(static_cast<uint32_t>(state), std::memory_order_release);
+        futexWake(slot.state);
+    }
+
+    // one image per backend, size and resize; a job for an image already in flight in this pass waits for it first
+    Imagef& cachedImage(const Job& job)
+    {
+        const ImageKey key{ static_cast<int>(job.backend), job.width, job.height, job.nrChannels, job.resize.width, job.resize.height,
+                            static_cast<int>(job.resize.filter), static_cast<int>(job.resize.format) };
+        auto found = m_images.find(key);
+        if (found == m_images.end()) {
+            if (m_images.size() >= m_maxImages) evictImage();
+            std::unique_ptr<Imagef> image = m_factory(job);
+            checkErrorCode<bool, true>(image != nullptr, "failed to create image, unknown backend!");
+            image->setValidation(m_validate);
+            found = m_images.emplace(key, CachedImage{ std::move(image), 0 }).first;
+        }
+        found->second.lastUsed = ++m_useCount;
+        Imagef* image = found->second.image.get();
+        waitRunning(image);
+        return *image;
+    }
+
+    // the least recently used image, its frame of this pass finished first
+    void evictImage()
+    {
+        auto oldest = std::min_element(m_images.begin(), m_images.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUsed < b.second.lastUsed;
+        });
+        waitRunning(oldest->second.image.get());
+        m_images.erase(oldest);
+    }
+
+    void waitRunning(const Imagef* image)
+    {
+        for (size_t i = 0; i < m_running.size(); ++i) {
+            if (m_running[i].image != image) continue;
+            finishJob(m_running[i]);
+            m_running.erase(m_running.begin() + i);
+            return;
+        }
+    }
+
+    const std::string m_socketPath;
+    Factory m_factory;
+    const size_t m_maxImages;
+    const bool m_validate;
+    int m_listener;
+    std::atomic<bool> m_stopping;
+    uint64_t m_useCount;
+    std::vector<Connection> m_connections;
+    std::vector<Running> m_running;
+    std::map<ImageKey, CachedImage> m_images;
+};
+
+}
+
+}
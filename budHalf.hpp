@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace bud {
+
+// IEEE 754 binary16 storage, arithmetic goes through float
+class half {
+public:
+    half() = default;
+    half(const float value) : m_bits(fromFloat(value)) {}
+
+    operator float() const { return toFloat(m_bits); }
+
+    uint16_t bits() const { return m_bits; }
+
+    static half fromBits(const uint16_t bits)
+    {
+        half value;
+        value.m_bits = bits;
+        return value;
+    }
+
+    // relative error of rounding one value to half, 2^-11
+    static constexpr float unitRoundoff() { return 1.0f / 2048.0f; }
+
+private:
+    // round to nearest even, overflow saturates to infinity
+    static uint16_t fromFloat(const float value)
+    {
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        const uint16_t sign = static_cast<uint16_t>((f >> 16) & 0x8000u);
+        const uint32_t exponent = (f >> 23) & 0xffu;
+        uint32_t mantissa = f & 0x7fffffu;
+
+        if (exponent == 0xffu) return sign | 0x7c00u | (mantissa ? 0x200u : 0u);
+        const int unbiased = static_cast<int>(exponent) - 127 + 15;
+        if (unbiased >= 0x1f) return sign | 0x7c00u;
+
+        if (unbiased <= 0) {
+            if (unbiased < -10) return sign;
+            mantissa |= 0x800000u;
+            const int shift = 14 - unbiased;
+            const uint32_t halfway = 1u << (shift - 1);
+            const uint32_t rest = mantissa & ((1u << shift) - 1);
+            uint32_t bits = mantissa >> shift;
+            if (rest > halfway || (rest == halfway && (bits & 1u))) ++bits;
+            return static_cast<uint16_t>(sign | bits);
+        }
+
+        uint32_t bits = (static_cast<uint32_t>(unbiased) << 10) | (mantissa >> 13);
+        const uint32_t rest = mantissa & 0x1fffu;
+        if (rest > 0x1000u || (rest == 0x1000u && (bits & 1u))) ++bits;
+        return static_cast<uint16_t>(sign | bits);
+    }
+
+    static float toFloat(const uint16_t bits)
+    {
+        const uint32_t sign = static_cast<uint32_t>(bits & 0x8000u) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1fu;
+        uint32_t mantissa = bits & 0x3ffu;
+
+        uint32_t f;
+        if (exponent == 0x1fu) {
+            f = sign | 0x7f800000u | (mantissa << 13);
+        } else if (exponent) {
+            f = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        } else if (mantissa) {
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400u)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            f = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+        } else {
+            f = sign;
+        }
+
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+
+    uint16_t m_bits;
+};
+
+static_assert(sizeof(half) == 2, "half must match the 16-bit device formats");
+
+}
@@ -1,64 +1,561 @@
-#pragma once
-
-#include <vector>
-#include <algorithm>
-#include <iostream>
-#include <budUtils.hpp>
-
-namespace bud {
-
-template<typename T>
-class Image {
-public:
-    explicit Image(const int width, const int height, const int nrChannels)
-        : m_width(width), m_height(height), m_nrChannels(nrChannels) {
-        genImageData();
-    }
-
-    virtual void compute() = 0;
-
-    const int m_width;
-    const int m_height;
-    const int m_nrChannels;
-    std::vector<T> m_data;
-
-    bool validateImageData(const std::vector<T>& got)
-    {
-        if (got.size() != m_data.size()) return false;
-        for (size_t i = 0; i < got.size(); ++i) {
-            if (std::abs(got[i] - m_data[i]) > epsilon()) return false;
-        }
-        return true;
-    }
-
-private:
-    void genImageData()
-    {
-        m_data.resize(m_width * m_height * m_nrChannels);
-        std::for_each(m_data.begin(), m_data.end(), [](auto& data) {
-            data = genRandomData<T>(127, 0);
-        });
-    }
-
-    virtual const T epsilon() = 0;
-};
-
-class Imagef : public Image<float> {
-public:
-    explicit Imagef(const int width, const int height, const int nrChannels)
-        : Image<float>(width, height, nrChannels) {}
-
-private:
-    const float epsilon() final override { return 0.01f; }
-};
-
-class Imageu8 : public Image<uint8_t> {
-public:
-    explicit Imageu8(const int width, const int height, const int nrChannels)
-        : Image<uint8_t>(width, height, nrChannels) {}
-
-private:
-    const uint8_t epsilon() final override { return 0; }
-};
-
-}
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <exception>
+#include <type_traits>
+#include <functional>
+#include <budUtils.hpp>
+#include <budResize.hpp>
+#include <budPool.hpp>
+#include <budHalf.hpp>
+#include <budConvert.hpp>
+#include <budRegion.hpp>
+#include <budAsync.hpp>
+#include <budTraits.hpp>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+namespace bud {
+
+// a readback against the host reference of a resize, narrow output is compared with the reference rounded like the device rounds it
+template<typename U>
+inline bool matchesResize(const PixelBuffer<U>& got, const PixelBuffer<float>& expected, const Resize& resize, const float tolerance,
+                          const float relative)
+{
+    if (got.size() != expected.size()) return false;
+    for (size_t i = 0; i < got.size(); ++i) {
+        float value = resize.format == Format::RGBA8 ? std::round(std::clamp(expected[i], 0.0f, 255.0f)) : expected[i];
+        if (std::abs(static_cast<float>(got[i]) - value) > tolerance + relative * std::abs(value)) return false;
+    }
+    return true;
+}
+
+// the host side both kinds of image share: test data, and a readback checked against the interleaved source with the
+// per-pixel loops on a compile-time channel count; dynamicChannels falls back to nrChannels
+template<typename T>
+inline PixelBuffer<T> genImageData(const size_t size)
+{
+    PixelBuffer<T> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = genRandomData<T>(127, 0, i);
+    return data;
+}
+
+template<int Channels, typename U, typename T>
+inline bool validateImageData(const PixelBuffer<U>& got, const PixelBuffer<T>& source, const int width, const int height,
+                              const int nrChannels, const Resize& resize, const float epsilon)
+{
+    // half readback is widened in bulk rather than per comparison
+    if constexpr (std::is_same<U, half>::value) {
+        PixelBuffer<float> widened(got.size());
+        convertPixels(got.data(), widened.data(), got.size());
+        return validateImageData<Channels>(widened, source, width, height, nrChannels, resize, epsilon);
+    } else {
+        if (resize.filter == Filter::None) {
+            if (got.size() != source.size()) return false;
+            for (size_t i = 0; i < got.size(); ++i) {
+                if (std::abs(static_cast<float>(got[i]) - static_cast<float>(source[i])) > epsilon) return false;
+            }
+            return true;
+        }
+
+        const PixelBuffer<float> expected = resizeImageData<Channels>(source, width, height, nrChannels, resize);
+        return matchesResize(got, expected, resize, resizeTolerance(resize, epsilon), relativeTolerance(resize, width, height));
+    }
+}
+
+// Image<T> is the runtime-polymorphic image the backends implement, Image<T, Channels, Layout> a fixed configuration
+template<typename T, int Channels = dynamicChannels, Layout L = Layout::Interleaved>
+class Image;
+
+// sizes and channel count are only known at runtime; the per-pixel loops still run with a compile-time
+// channel count, picked once per call by withChannels()
+template<typename T>
+class Image<T, dynamicChannels, Layout::Interleaved> {
+public:
+    explicit Image(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : m_width(width), m_height(height), m_nrChannels(nrChannels), m_resize(normalizeResize(resize, width, height)),
+          m_importPending(false), m_output(nullptr), m_outputBytes(0), m_outputConverted(false), m_outputLayout(PixelLayout::RGBA8), m_outputScale(1.0f),
+          m_validation(true) {
+        genImageData();
+    }
+
+    virtual ~Image() = default;
+
+    virtual void compute() = 0;
+
+    // submits the frame and returns at once, the future is ready when the completion thread has read it back and validated it;
+    // m_data must not change before that, and a previous asynchronous frame of this image is waited for first
+    std::future<void> computeAsync()
+    {
+        auto promise = std::make_shared<std::promise<void>>();
+        std::future<void> future = promise->get_future();
+        try {
+            enqueueFrame([promise](const std::exception_ptr& error) {
+                if (error) {
+                    promise->set_exception(error);
+                } else {
+                    promise->set_value();
+                }
+            });
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+        return future;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    // where a co_await resumes, given the continuation; by default the resume thread of CompletionThread
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // co_await rethrows what the frame threw and never resumes on the completion thread, so the coroutine may compute again;
+    // ImageGL creates its window on the thread of its first frame, which GLFW wants to be the main one,
+    // so give its first co_await an executor that resumes there or compute() it once beforehand
+    class ComputeAwaitable {
+    public:
+        explicit ComputeAwaitable(Image& image, Executor executor = {}) : m_image(image), m_executor(std::move(executor)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            try {
+                m_image.enqueueFrame([this, handle](const std::exception_ptr& error) {
+                    m_error = error;
+                    if (m_executor) {
+                        m_executor([handle] { handle.resume(); });
+                    } else {
+                        CompletionThread::instance().post([handle] { handle.resume(); });
+                    }
+                });
+            } catch (...) {
+                m_error = std::current_exception();
+                return false;
+            }
+            return true;
+        }
+
+        void await_resume() const
+        {
+            if (m_error) std::rethrow_exception(m_error);
+        }
+
+    private:
+        Image& m_image;
+        Executor m_executor;
+        std::exception_ptr m_error;
+    };
+
+    ComputeAwaitable computeAwaitable(Executor executor = {}) { return ComputeAwaitable(*this, std::move(executor)); }
+#endif
+
+    const int m_width;
+    const int m_height;
+    const int m_nrChannels;
+    const Resize m_resize;
+    PixelBuffer<T> m_data;
+
+    template<typename U>
+    bool validateImageData(const PixelBuffer<U>& got)
+    {
+        return validateImageData(got, m_data);
+    }
+
+    // against the frame that was submitted, which m_data may no longer be while several frames are in flight
+    template<typename U>
+    bool validateImageData(const PixelBuffer<U>& got, const PixelBuffer<T>& source)
+    {
+        const float tolerance = static_cast<float>(epsilon());
+        return withChannels(m_nrChannels, [&](auto channels) {
+            return bud::validateImageData<decltype(channels)::value>(got, source, m_width, m_height, m_nrChannels, m_resize, tolerance);
+        });
+    }
+
+    // the next frame from 8-bit pixels, each scaled by scale; Planar8 reads planes[0..3], the others src.
+    // the backends defer it to the upload, which widens each row into m_data and converts it into staging memory while
+    // it is still in cache: src must then stay valid, and m_data is not updated, until the next frame is submitted
+    void importPixels(const PixelLayout layout, const uint8_t* src, const uint8_t* const* planes = nullptr,
+                      const float scale = 1.0f)
+    {
+        static_assert(std::is_same<T, float>::value, "8-bit pixels import into float images only");
+        checkErrorCode<int, 4>(m_nrChannels, "failed to import pixels, the image is not RGBA!");
+        m_import = PixelImport{};
+        m_import.layout = layout;
+        m_import.src = src;
+        if (planes) std::copy(planes, planes + 4, m_import.planes);
+        m_import.scale = scale;
+        m_importPending = true;
+        if (!deferImports()) applyImport();
+    }
+
+    // later frames also copy their readback here, in the destination format; null stops it
+    void setOutput(void* data, const size_t bytes)
+    {
+        m_output = data;
+        m_outputBytes = bytes;
+        m_outputConverted = false;
+    }
+
+    // the same, but RGBA readback is narrowed to 8 bits (float and half multiplied by scale) and laid out as layout;
+    // Planar8 fills four consecutive planes of the output
+    void setOutput(void* data, const size_t bytes, const PixelLayout layout, const float scale = 1.0f)
+    {
+        checkErrorCode<int, 4>(m_nrChannels, "failed to convert output, the image is not RGBA!");
+        m_output = data;
+        m_outputBytes = bytes;
+        m_outputConverted = true;
+        m_outputLayout = layout;
+        m_outputScale = scale;
+    }
+
+    // off for images whose readback is only passed on, such as the daemon's: no host reference, no report
+    void setValidation(const bool enabled)
+    {
+        m_validation = enabled;
+    }
+
+    bool validation() const
+    {
+        return m_validation;
+    }
+
+    // frames after the first only upload and recompute what changed, either marked here or found by diffing m_data
+    void markDirty(const Rect& rect)
+    {
+        const Rect clipped = clipRect(rect, m_width, m_height);
+        if (!clipped.empty()) m_dirtyRegions.push_back(clipped);
+    }
+
+protected:
+    // true for images whose upload goes through takeDirtyRegions() and uploadRect(), which then import in one pass
+    virtual bool deferImports() const
+    {
+        return false;
+    }
+
+    // held by compute() and by a submit until its frame is in flight, eviction only tries it,
+    // so the device objects are never released under a frame another thread is running
+    std::mutex m_useMutex;
+
+    // the asynchronous half of compute(): queues the frame without waiting for the device,
+    // images without one compute synchronously
+    virtual std::unique_ptr<PendingJob> submitJob()
+    {
+        compute();
+        return std::make_unique<CompletedJob>();
+    }
+
+    // the readback of a frame, copied to the output of setOutput() and validated
+    template<typename U>
+    bool acceptImageData(const PixelBuffer<U>& got)
+    {
+        return acceptImageData(got, m_data);
+    }
+
+    template<typename U>
+    bool acceptImageData(const PixelBuffer<U>& got, const PixelBuffer<T>& source)
+    {
+        if (m_output && m_outputConverted) {
+            exportImageData(got);
+        } else if (m_output) {
+            checkErrorCode<bool, true>(got.size() * sizeof(U) <= m_outputBytes, "failed to copy output, buffer too small!");
+            std::memcpy(m_output, got.data(), got.size() * sizeof(U));
+        }
+        return !m_validation || validateImageData(got, source);
+    }
+
+    template<typename U>
+    void exportImageData(const PixelBuffer<U>& got)
+    {
+        const size_t pixels = got.size() / 4;
+        checkErrorCode<bool, true>(layoutBytes(m_outputLayout, pixels) <= m_outputBytes, "failed to copy output, buffer too small!");
+        uint8_t* bytes = static_cast<uint8_t*>(m_output);
+        uint8_t* const planes[4] = { bytes, bytes + pixels, bytes + 2 * pixels, bytes + 3 * pixels };
+        if constexpr (std::is_same<U, half>::value) {
+            PixelBuffer<float> widened(got.size());
+            convertPixels(got.data(), widened.data(), got.size());
+            exportPixels(m_outputLayout, widened.data(), bytes, planes, pixels, m_outputScale);
+        } else {
+            exportPixels(m_outputLayout, got.data(), bytes, planes, pixels, m_outputScale);
+        }
+    }
+
+    // compute(), eviction and destruction first let a pending asynchronous frame finish;
+    // on the completion thread that would wait for itself, so it fails instead.
+    // they may run on other threads than the submit, so the future is copied under its lock and waited on outside it
+    void waitInFlight()
+    {
+        std::shared_future<void> inFlight;
+        {
+            std::lock_guard<std::mutex> lock(m_inFlightMutex);
+            inFlight = m_inFlight;
+        }
+        if (!inFlight.valid()) return;
+        const bool blocks = inFlight.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+        checkErrorCode<bool, false>(blocks && CompletionThread::instance().isCurrent(),
+                                    "failed to wait for frame, the completion thread would deadlock!");
+        inFlight.wait();
+    }
+
+    // the source rectangles of this frame, the whole image on the first one and after an import
+    std::vector<Rect> takeDirtyRegions(const int tileSize)
+    {
+        std::vector<Rect> regions;
+        if (m_importPending) {
+            // uploadRect() writes the diff base along with m_data
+            regions.push_back({ 0, 0, m_width, m_height });
+            m_previousData.resize(m_data.size());
+        } else if (m_previousData.empty()) {
+            regions.push_back({ 0, 0, m_width, m_height });
+            m_previousData = m_data;
+        } else {
+            regions = m_dirtyRegions.empty() ? diffRegions(m_previousData, m_data, m_width, m_height, m_nrChannels, tileSize)
+                                             : m_dirtyRegions;
+            for (const Rect& rect : regions) {
+                for (int y = rect.y; y < rect.bottom(); ++y) {
+                    const size_t first = (static_cast<size_t>(y) * m_width + rect.x) * m_nrChannels;
+                    std::copy_n(m_data.begin() + first, rect.width * m_nrChannels, m_previousData.begin() + first);
+                }
+            }
+        }
+        m_dirtyRegions.clear();
+        return regions;
+    }
+
+    // rows of rect to dst in the device type U, and with a pending import the one rect of the frame, imported on the way
+    template<typename U>
+    void uploadRect(const Rect& rect, void* dst, const size_t dstRowPitch)
+    {
+        if (!m_importPending) return copyRect<U>(m_data, m_width, m_nrChannels, rect, dst, dstRowPitch);
+        importRect<U>(m_import, m_width, rect, m_data.data(), m_previousData.data(), dst, dstRowPitch);
+        m_importPending = false;
+    }
+
+    // a pending import into m_data alone, for uploads that read m_data in place
+    void applyImport()
+    {
+        if (!m_importPending) return;
+        const size_t pixels = static_cast<size_t>(m_width) * m_height;
+        bud::importPixels(m_import.layout, m_import.src, m_import.planes, m_data.data(), pixels, m_import.scale);
+        if (!m_previousData.empty()) std::copy(m_data.begin(), m_data.end(), m_previousData.begin());
+        m_importPending = false;
+    }
+
+    // after the device copy is gone the next frame uploads everything again
+    void resetFrames()
+    {
+        m_previousData.clear();
+        m_dirtyRegions.clear();
+    }
+
+    // texel bytes of the source and intermediate images, half precision only in RGBA16F mode
+    size_t storageTexelBytes() const
+    {
+        return m_nrChannels * channelSize(m_resize.format == Format::RGBA16F ? Format::RGBA16F : Format::RGBA32F);
+    }
+
+    size_t srcImageBytes() const
+    {
+        return static_cast<size_t>(m_width) * m_height * storageTexelBytes();
+    }
+
+    size_t dstImageBytes() const
+    {
+        return static_cast<size_t>(m_resize.width) * m_resize.height * m_nrChannels * channelSize(m_resize.format);
+    }
+
+    // source, intermediate and destination images as the backends allocate them
+    size_t deviceImageBytes() const
+    {
+        size_t bytes = srcImageBytes() + dstImageBytes();
+        if (isSeparable(m_resize.filter)) bytes += static_cast<size_t>(m_resize.width) * m_height * storageTexelBytes();
+        return bytes;
+    }
+
+    // what a frame uploads for these dirty regions
+    size_t uploadBytes(const std::vector<Rect>& regions) const
+    {
+        size_t bytes = 0;
+        for (const Rect& rect : regions) bytes += static_cast<size_t>(rect.width) * rect.height * storageTexelBytes();
+        return bytes;
+    }
+
+private:
+    void genImageData()
+    {
+        m_data = bud::genImageData<T>(static_cast<size_t>(m_width) * m_height * m_nrChannels);
+    }
+
+    virtual const T epsilon() = 0;
+
+    // in flight until the completion thread has finished the job, settled before done runs so done may compute again
+    void enqueueFrame(std::function<void(const std::exception_ptr&)> done)
+    {
+        std::lock_guard<std::mutex> use(m_useMutex);
+        waitInFlight();
+        std::unique_ptr<PendingJob> job = submitJob();
+        auto settled = std::make_shared<std::promise<void>>();
+        {
+            std::lock_guard<std::mutex> lock(m_inFlightMutex);
+            m_inFlight = settled->get_future().share();
+        }
+        CompletionThread::instance().enqueue(std::move(job), [settled, done](const std::exception_ptr& error) {
+            settled->set_value();
+            done(error);
+        });
+    }
+
+    PixelBuffer<T> m_previousData;
+    std::vector<Rect> m_dirtyRegions;
+    std::mutex m_inFlightMutex;
+    std::shared_future<void> m_inFlight;
+    PixelImport m_import;
+    bool m_importPending;
+    void* m_output;
+    size_t m_outputBytes;
+    bool m_outputConverted;
+    PixelLayout m_outputLayout;
+    float m_outputScale;
+    bool m_validation;
+};
+
+class Imagef : public Image<float> {
+public:
+    explicit Imagef(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Image<float>(width, height, nrChannels, resize), m_tolerance(PixelTraits<float>::epsilon()) {}
+
+    // the readback tolerance, looser for a device format narrower than the float pixels; set before the first frame
+    void setTolerance(const float tolerance)
+    {
+        m_tolerance = tolerance;
+    }
+
+private:
+    const float epsilon() final override { return m_tolerance; }
+
+    float m_tolerance;
+};
+
+// a backend image in the fixed configuration Traits: its channel count, its format as the device storage format and
+// its tolerance for the readback; the host pixels stay float and interleaved, as every backend uploads them
+template<typename Backend, typename Traits>
+inline std::unique_ptr<Backend> makeDeviceImage(const int width, const int height, Resize resize = Resize{})
+{
+    static_assert(std::is_base_of<Imagef, Backend>::value, "the backends are float images");
+    static_assert(Traits::channels == 4, "the backends allocate and transfer RGBA only");
+    static_assert(Traits::layout == Layout::Interleaved, "the backends upload interleaved pixels");
+    resize.format = Traits::format;
+    auto image = std::make_unique<Backend>(width, height, Traits::channels, resize);
+    image->setTolerance(Traits::epsilon());
+    return image;
+}
+
+class Imageu8 : public Image<uint8_t> {
+public:
+    explicit Imageu8(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Image<uint8_t>(width, height, nrChannels, resize) {}
+
+private:
+    const uint8_t epsilon() final override { return PixelTraits<uint8_t>::epsilon(); }
+};
+
+class Imageh : public Image<half> {
+public:
+    explicit Imageh(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Image<half>(width, height, nrChannels, resize) {}
+
+private:
+    const half epsilon() final override { return half(PixelTraits<half>::epsilon()); }
+};
+
+// a fixed configuration: channel count, layout, device format and tolerance are constexpr and nothing is virtual,
+// Derived supplies computeFrame(); planar data is interleaved once per call before the per-pixel loops
+template<typename Derived, typename T, int Channels, Layout L>
+class FixedImage {
+public:
+    using Traits = ImageTraits<T, Channels, L>;
+
+    explicit FixedImage(const int width, const int height, const Resize& resize = Resize{ 0, 0, Filter::None, Traits::format })
+        : m_width(width), m_height(height), m_resize(normalizeResize(resize, width, height)) {
+        genImageData();
+    }
+
+    void compute() { static_cast<Derived&>(*this).computeFrame(); }
+
+    static constexpr float epsilon() { return PixelTraits<T>::epsilon(); }
+
+    const int m_width;
+    const int m_height;
+    const Resize m_resize;
+    // Channels planes of m_width * m_height when planar
+    PixelBuffer<T> m_data;
+
+    template<typename U>
+    bool validateImageData(const PixelBuffer<U>& got) const
+    {
+        return withInterleaved([&](const PixelBuffer<T>& data) {
+            return bud::validateImageData<Channels>(got, data, m_width, m_height, Channels, m_resize, epsilon());
+        });
+    }
+
+protected:
+    // fn sees the pixels interleaved, what the devices and the host reference read
+    template<typename Function>
+    decltype(auto) withInterleaved(Function&& fn) const
+    {
+        if constexpr (L == Layout::Interleaved) {
+            return fn(m_data);
+        } else {
+            const size_t pixels = static_cast<size_t>(m_width) * m_height;
+            const T* planes[Channels];
+            for (int c = 0; c < Channels; ++c) planes[c] = m_data.data() + c * pixels;
+            PixelBuffer<T> interleaved(m_data.size());
+            planarToInterleaved(planes, Channels, interleaved.data(), pixels);
+            return fn(interleaved);
+        }
+    }
+
+private:
+    // the pixels of the interleaved image of the same size, in planes when planar
+    void genImageData()
+    {
+        const size_t pixels = static_cast<size_t>(m_width) * m_height;
+        m_data = bud::genImageData<T>(pixels * Channels);
+        if constexpr (L == Layout::Planar) {
+            const PixelBuffer<T> interleaved = std::move(m_data);
+            m_data.resize(interleaved.size());
+            T* planes[Channels];
+            for (int c = 0; c < Channels; ++c) planes[c] = m_data.data() + c * pixels;
+            interleavedToPlanar(interleaved.data(), Channels, planes, pixels);
+        }
+    }
+};
+
+// the host path of a fixed configuration, the resize reference computed on the CPU
+template<typename T, int Channels, Layout L>
+class Image final : public FixedImage<Image<T, Channels, L>, T, Channels, L> {
+public:
+    using FixedImage<Image, T, Channels, L>::FixedImage;
+
+    // interleaved, in float like the host reference
+    PixelBuffer<float> m_result;
+
+private:
+    friend class FixedImage<Image, T, Channels, L>;
+
+    void computeFrame()
+    {
+        m_result = this->withInterleaved([this](const PixelBuffer<T>& data) {
+            return resizeImageData<Channels>(data, this->m_width, this->m_height, Channels, this->m_resize);
+        });
+    }
+};
+
+}
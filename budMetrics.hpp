@@ -0,0 +1,382 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <budUtils.hpp>
+#include <budPool.hpp>
+#include <budBudget.hpp>
+
+namespace bud {
+
+enum class Stage {
+    Setup,
+    Upload,
+    Dispatch,
+    Readback,
+    Validate,
+    Device
+};
+
+// counters and stage latency histograms of compute(), sharded per thread and summed on export
+class Metrics {
+public:
+    static constexpr size_t backendCount = 3;
+    static constexpr size_t stageCount = 6;
+    static constexpr size_t shardCount = 16;
+    // latency bucket upper bounds double from 10us, the last bucket is +Inf
+    static constexpr size_t bucketCount = 21;
+    static constexpr uint64_t firstBucketBound = 10000;
+
+    static Metrics& instance()
+    {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    // nanoseconds since the first use of the metrics, the time base of the trace
+    uint64_t now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count());
+    }
+
+    void jobStarted(const Backend backend)
+    {
+        counters(backend).queueDepth.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void jobEnded(const Backend backend)
+    {
+        counters(backend).queueDepth.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // pixels are source pixels, so resizes of the same input compare
+    void jobCompleted(const Backend backend, const size_t pixels)
+    {
+        BackendCounters& backendCounters = counters(backend);
+        backendCounters.jobs.fetch_add(1, std::memory_order_relaxed);
+        backendCounters.pixels.fetch_add(pixels, std::memory_order_relaxed);
+    }
+
+    void uploaded(const Backend backend, const size_t bytes)
+    {
+        counters(backend).uploadedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void downloaded(const Backend backend, const size_t bytes)
+    {
+        counters(backend).downloadedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void shaderCacheLookup(const bool hit)
+    {
+        (hit ? shard().shaderCacheHits : shard().shaderCacheMisses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // start is from now(), host stages run on the calling thread, device spans on a lane of their backend
+    void recordStage(const Backend backend, const Stage stage, const uint64_t start, const uint64_t duration)
+    {
+        BackendCounters& backendCounters = counters(backend);
+        backendCounters.latencyBuckets[index(stage)][bucketIndex(duration)].fetch_add(1, std::memory_order_relaxed);
+        backendCounters.latencySum[index(stage)].fetch_add(duration, std::memory_order_relaxed);
+        if (!m_tracing.load(std::memory_order_relaxed)) return;
+
+        const uint64_t lane = stage == Stage::Device ? deviceLane(backend) : threadId();
+        std::lock_guard<std::mutex> lock(m_traceMutex);
+        m_spans.push_back({ backend, stage, lane, start, duration });
+    }
+
+    // spans are only kept while tracing, the counters are always on
+    void enableTrace(const bool enabled)
+    {
+        m_tracing.store(enabled, std::memory_order_relaxed);
+    }
+
+    uint64_t jobs(const Backend backend) const { return sum(backend, &BackendCounters::jobs); }
+    uint64_t pixels(const Backend backend) const { return sum(backend, &BackendCounters::pixels); }
+    uint64_t uploadedBytes(const Backend backend) const { return sum(backend, &BackendCounters::uploadedBytes); }
+    uint64_t downloadedBytes(const Backend backend) const { return sum(backend, &BackendCounters::downloadedBytes); }
+
+    int64_t queueDepth(const Backend backend) const
+    {
+        int64_t depth = 0;
+        for (const Shard& shard : m_shards) depth += shard.backends[index(backend)].queueDepth.load(std::memory_order_relaxed);
+        return depth;
+    }
+
+    std::array<uint64_t, bucketCount> latencyBuckets(const Backend backend, const Stage stage) const
+    {
+        std::array<uint64_t, bucketCount> buckets{};
+        for (const Shard& shard : m_shards) {
+            for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+                buckets[bucket] += shard.backends[index(backend)].latencyBuckets[index(stage)][bucket].load(std::memory_order_relaxed);
+            }
+        }
+        return buckets;
+    }
+
+    // linear within the bucket holding the quantile, in seconds
+    double latencyQuantile(const Backend backend, const Stage stage, const double quantile) const
+    {
+        const std::array<uint64_t, bucketCount> buckets = latencyBuckets(backend, stage);
+        uint64_t count = 0;
+        for (const uint64_t bucket : buckets) count += bucket;
+        if (!count) return 0.0;
+
+        const double rank = quantile * count;
+        double seen = 0.0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            if (seen + buckets[bucket] >= rank && buckets[bucket]) {
+                const double lower = bucket ? bucketBound(bucket - 1) : 0.0;
+                // the +Inf bucket reports its lower bound
+                if (bucket == bucketCount - 1) return lower * 1e-9;
+                const double upper = bucketBound(bucket);
+                return (lower + (upper - lower) * (rank - seen) / buckets[bucket]) * 1e-9;
+            }
+            seen += buckets[bucket];
+        }
+        return bucketBound(bucketCount - 2) * 1e-9;
+    }
+
+    // the Prometheus text exposition format, rates such as jobs/s and megapixels/s come from rate() over the totals
+    std::string prometheus() const
+    {
+        std::ostringstream out;
+        writeCounter(out, "bud_jobs_total", "Completed compute() calls.", &BackendCounters::jobs);
+        writeCounter(out, "bud_pixels_total", "Source pixels of completed compute() calls.", &BackendCounters::pixels);
+        writeCounter(out, "bud_uploaded_bytes_total", "Bytes uploaded to the device.", &BackendCounters::uploadedBytes);
+        writeCounter(out, "bud_downloaded_bytes_total", "Bytes read back from the device.", &BackendCounters::downloadedBytes);
+
+        out << "# HELP bud_queue_depth Jobs submitted and not yet completed.\n# TYPE bud_queue_depth gauge\n";
+        for (size_t backend = 0; backend < backendCount; ++backend) {
+            out << "bud_queue_depth{backend=\"" << backendName(backend) << "\"} " << queueDepth(static_cast<Backend>(backend)) << "\n";
+        }
+
+        out << "# HELP bud_stage_latency_seconds Latency of the stages of compute(), device is measured on the GPU.\n"
+            << "# TYPE bud_stage_latency_seconds histogram\n";
+        for (size_t backend = 0; backend < backendCount; ++backend) {
+            for (size_t stage = 0; stage < stageCount; ++stage) writeHistogram(out, backend, stage);
+        }
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        for (const Shard& shard : m_shards) {
+            hits += shard.shaderCacheHits.load(std::memory_order_relaxed);
+            misses += shard.shaderCacheMisses.load(std::memory_order_relaxed);
+        }
+        out << "# HELP bud_shader_cache_lookups_total SPIR-V cache lookups.\n# TYPE bud_shader_cache_lookups_total counter\n"
+            << "bud_shader_cache_lookups_total{result=\"hit\"} " << hits << "\n"
+            << "bud_shader_cache_lookups_total{result=\"miss\"} " << misses << "\n";
+
+        const PoolStats pool = PixelPool::instance().stats();
+        out << "# HELP bud_pixel_pool_acquires_total Host pixel buffer acquires, misses are allocations.\n"
+            << "# TYPE bud_pixel_pool_acquires_total counter\n"
+            << "bud_pixel_pool_acquires_total{result=\"hit\"} " << pool.hits << "\n"
+            << "bud_pixel_pool_acquires_total{result=\"miss\"} " << pool.misses << "\n"
+            << "# HELP bud_pixel_pool_mapped_bytes Host memory mapped by the pixel pool.\n# TYPE bud_pixel_pool_mapped_bytes gauge\n"
+            << "bud_pixel_pool_mapped_bytes " << pool.mappedBytes << "\n"
+            << "# HELP bud_pixel_pool_free_bytes Mapped pixel pool memory not in use.\n# TYPE bud_pixel_pool_free_bytes gauge\n"
+            << "bud_pixel_pool_free_bytes " << pool.freeBytes << "\n";
+
+        MemoryBudget& budget = MemoryBudget::instance();
+        out << "# HELP bud_device_memory_bytes Device memory accounted by the memory budget.\n# TYPE bud_device_memory_bytes gauge\n";
+        for (size_t backend = 0; backend < backendCount; ++backend) {
+            const Backend id = static_cast<Backend>(backend);
+            out << "bud_device_memory_bytes{backend=\"" << backendName(backend) << "\",resource=\"image\"} " << budget.used(id, Resource::Image) << "\n"
+                << "bud_device_memory_bytes{backend=\"" << backendName(backend) << "\",resource=\"staging\"} " << budget.used(id, Resource::Staging) << "\n";
+        }
+        out << "# HELP bud_evictions_total Images evicted to stay under the memory budget.\n# TYPE bud_evictions_total counter\n"
+            << "bud_evictions_total " << budget.evictions() << "\n";
+        return out.str();
+    }
+
+    // written next to the target and renamed over it, so the node_exporter textfile collector never reads half a file;
+    // rename() does not replace an existing file on Windows, there the old one is removed first
+    void writePrometheus(const std::string& fileName) const
+    {
+        const std::string tmpName = fileName + ".tmp";
+        {
+            std::ofstream file(tmpName, std::ios::trunc);
+            file << prometheus();
+            checkErrorCode<bool, true>(static_cast<bool>(file), "failed to write metrics file!");
+        }
+        if (std::rename(tmpName.c_str(), fileName.c_str()) == 0) return;
+        std::remove(fileName.c_str());
+        checkErrorCode<int, 0>(std::rename(tmpName.c_str(), fileName.c_str()), "failed to replace metrics file!");
+    }
+
+    // the spans recorded while tracing as chrome://tracing JSON, timestamps in microseconds
+    void writeTrace(const std::string& fileName) const
+    {
+        std::ofstream file(fileName, std::ios::trunc);
+        file << "{\"traceEvents\":[";
+        for (size_t backend = 0; backend < backendCount; ++backend) {
+            file << (backend ? "," : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << deviceLane(static_cast<Backend>(backend))
+                 << ",\"args\":{\"name\":\"" << backendName(backend) << " device\"}}";
+        }
+
+        std::lock_guard<std::mutex> lock(m_traceMutex);
+        for (const Span& span : m_spans) {
+            file << ",{\"name\":\"" << stageName(index(span.stage)) << "\",\"cat\":\"" << backendName(index(span.backend))
+                 << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.lane << ",\"ts\":" << span.start / 1000.0
+                 << ",\"dur\":" << span.duration / 1000.0 << "}";
+        }
+        file << "]}\n";
+        checkErrorCode<bool, true>(static_cast<bool>(file), "failed to write trace file!");
+    }
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+private:
+    Metrics() : m_epoch(std::chrono::steady_clock::now()) {}
+
+    struct BackendCounters {
+        std::atomic<uint64_t> jobs{ 0 };
+        std::atomic<uint64_t> pixels{ 0 };
+        std::atomic<uint64_t> uploadedBytes{ 0 };
+        std::atomic<uint64_t> downloadedBytes{ 0 };
+        std::atomic<int64_t> queueDepth{ 0 };
+        std::array<std::array<std::atomic<uint64_t>, bucketCount>, stageCount> latencyBuckets{};
+        std::array<std::atomic<uint64_t>, stageCount> latencySum{};
+    };
+
+    // one per group of threads, aligned so threads on different shards never share a cache line
+    struct alignas(64) Shard {
+        std::array<BackendCounters, backendCount> backends;
+        std::atomic<uint64_t> shaderCacheHits{ 0 };
+        std::atomic<uint64_t> shaderCacheMisses{ 0 };
+    };
+
+    struct Span {
+        Backend backend;
+        Stage stage;
+        uint64_t lane;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    static size_t index(const Backend backend) { return static_cast<size_t>(backend); }
+    static size_t index(const Stage stage) { return static_cast<size_t>(stage); }
+
+    static const char* backendName(const size_t backend)
+    {
+        static const std::array<const char*, backendCount> names{ "opencl", "opengl", "vulkan" };
+        return names[backend];
+    }
+
+    static const char* stageName(const size_t stage)
+    {
+        static const std::array<const char*, stageCount> names{ "setup", "upload", "dispatch", "readback", "validate", "device" };
+        return names[stage];
+    }
+
+    static uint64_t bucketBound(const size_t bucket)
+    {
+        return firstBucketBound << bucket;
+    }
+
+    static size_t bucketIndex(const uint64_t duration)
+    {
+        size_t bucket = 0;
+        while (bucket < bucketCount - 1 && duration > bucketBound(bucket)) ++bucket;
+        return bucket;
+    }
+
+    static uint64_t threadId()
+    {
+        static std::atomic<uint64_t> nextId{ 1 };
+        thread_local const uint64_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    // device lanes sit above any plausible host thread id
+    static uint64_t deviceLane(const Backend backend)
+    {
+        return 1000 + index(backend);
+    }
+
+    Shard& shard()
+    {
+        return m_shards[threadId() % shardCount];
+    }
+
+    BackendCounters& counters(const Backend backend)
+    {
+        return shard().backends[index(backend)];
+    }
+
+    uint64_t sum(const Backend backend, std::atomic<uint64_t> BackendCounters::*counter) const
+    {
+        uint64_t total = 0;
+        for (const Shard& shard : m_shards) total += (shard.backends[index(backend)].*counter).load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void writeCounter(std::ostringstream& out, const std::string& name, const std::string& help,
+                      std::atomic<uint64_t> BackendCounters::*counter) const
+    {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+        for (size_t backend = 0; backend < backendCount; ++backend) {
+            out << name << "{backend=\"" << backendName(backend) << "\"} " << sum(static_cast<Backend>(backend), counter) << "\n";
+        }
+    }
+
+    void writeHistogram(std::ostringstream& out, const size_t backend, const size_t stage) const
+    {
+        const std::array<uint64_t, bucketCount> buckets = latencyBuckets(static_cast<Backend>(backend), static_cast<Stage>(stage));
+        uint64_t sumNanoseconds = 0;
+        for (const Shard& shard : m_shards) sumNanoseconds += shard.backends[backend].latencySum[stage].load(std::memory_order_relaxed);
+
+        const std::string labels = std::string("backend=\"") + backendName(backend) + "\",stage=\"" + stageName(stage) + "\"";
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            cumulative += buckets[bucket];
+            out << "bud_stage_latency_seconds_bucket{" << labels << ",le=\"";
+            if (bucket == bucketCount - 1) {
+                out << "+Inf";
+            } else {
+                out << bucketBound(bucket) * 1e-9;
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "bud_stage_latency_seconds_sum{" << labels << "} " << sumNanoseconds * 1e-9 << "\n"
+            << "bud_stage_latency_seconds_count{" << labels << "} " << cumulative << "\n";
+    }
+
+    const std::chrono::steady_clock::time_point m_epoch;
+    std::array<Shard, shardCount> m_shards;
+    std::atomic<bool> m_tracing{ false };
+    mutable std::mutex m_traceMutex;
+    std::vector<Span> m_spans;
+};
+
+// records the host time of one stage when it goes out of scope, exceptions included
+class StageTimer {
+public:
+    StageTimer(const Backend backend, const Stage stage)
+        : m_backend(backend), m_stage(stage), m_start(Metrics::instance().now()) {}
+
+    ~StageTimer()
+    {
+        Metrics& metrics = Metrics::instance();
+        metrics.recordStage(m_backend, m_stage, m_start, metrics.now() - m_start);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    const Backend m_backend;
+    const Stage m_stage;
+    const uint64_t m_start;
+};
+
+}
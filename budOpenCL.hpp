@@ -1,150 +1,385 @@
-#pragma once
-
-#include <vector>
-#include <array>
-#include <iostream>
-#include <CL/cl.h>
-#include "budUtils.hpp"
-#include "budImage.hpp"
-
-namespace bud {
-
-namespace cl {
-
-class ImageCL final : public Imagef {
-public:
-    explicit ImageCL(const int width, const int height, const int nrChannels)
-        : Imagef(width, height, nrChannels),
-          m_device(nullptr),
-          m_context(nullptr),
-          m_commandQueue(nullptr),
-          m_program(nullptr),
-          m_kernel(nullptr),
-          m_srcImage(nullptr),
-          m_dstImage(nullptr) {}
-
-    void compute() override
-    {
-        createContext();
-        createCommandQueue();
-        createProgramAndKernel();
-        createImages();
-        dispatch();
-        checkAnswer();
-        cleanup();
-    }
-private:
-    void createContext()
-    {
-        cl_uint numPlatforms;
-        cl_int err = clGetPlatformIDs(0, nullptr, &numPlatforms);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get platform number!");
-        std::vector<cl_platform_id> platforms(numPlatforms);
-        err = clGetPlatformIDs(platforms.size(), platforms.data(), nullptr);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get platforms!");
-
-        cl_uint numDevices;
-        err = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 0, nullptr, &numDevices);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get device number!");
-        std::vector<cl_device_id> devices(numDevices);
-        err = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, devices.size(), devices.data(), nullptr);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get devices!");
-        m_device = devices[0];
-
-        m_context = clCreateContext(nullptr, 1, &m_device, nullptr, nullptr, &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create context!");
-    }
-
-    void createCommandQueue()
-    {
-        cl_int err;
-        m_commandQueue = clCreateCommandQueue(m_context, m_device, 0, &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create command queue!");
-    }
-
-    void createProgramAndKernel()
-    {
-        const std::string kernelSource = readCodeFromFile("image.cl");
-        const char* source = kernelSource.c_str();
-        cl_int err;
-        m_program = clCreateProgramWithSource(m_context, 1, &source, nullptr, &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create program with source!");
-        err = clBuildProgram(m_program, 1, &m_device, nullptr, nullptr, nullptr);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to build program!");
-
-        m_kernel = clCreateKernel(m_program, "image", &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create kernel!");
-    }
-
-    void createImages()
-    {
-        cl_mem_flags srcFlags = CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR | CL_MEM_READ_ONLY;
-        cl_mem_flags dstFlags = CL_MEM_ALLOC_HOST_PTR | CL_MEM_WRITE_ONLY;
-        cl_image_format format{CL_RGBA, CL_FLOAT};
-        cl_image_desc desc{CL_MEM_OBJECT_IMAGE2D, m_width, m_height, 0, 0, 0, 0, 0, 0, nullptr};
-        cl_int err;
-        m_srcImage = clCreateImage(m_context, srcFlags, &format, &desc, m_data.data(), &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create image!");
-        m_dstImage = clCreateImage(m_context, dstFlags, &format, &desc, nullptr, &err);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create image!");
-    }
-
-    void dispatch()
-    {
-        cl_int err = clSetKernelArg(m_kernel, 0, sizeof(cl_mem), &m_srcImage);
-        err |= clSetKernelArg(m_kernel, 1, sizeof(cl_mem), &m_dstImage);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create image!");
-
-        constexpr cl_uint dim = 2;
-        std::array<size_t, dim> globalSize{m_width, m_height};
-        cl_event event;
-        err = clEnqueueNDRangeKernel(m_commandQueue, m_kernel, 2, nullptr, globalSize.data(), nullptr, 0, nullptr, &event);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to enqueue kernel!");
-
-        err = clFlush(m_commandQueue);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to flush queue!");
-
-        err = clWaitForEvents(1, &event);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to wait for event!");
-        clReleaseEvent(event);
-
-        err = clFinish(m_commandQueue);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to finish queue!");
-    }
-
-    void checkAnswer()
-    {
-        std::vector<float> got(m_data.size());
-        std::array<size_t, 3> origin{0, 0, 0};
-        std::array<size_t, 3> region{ m_width, m_height, 1 };
-        cl_int err = clEnqueueReadImage(m_commandQueue, m_dstImage, CL_TRUE, origin.data(), region.data(), 0, 0, got.data(), 0, nullptr, nullptr);
-        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to read image!");
-
-        bool valid = validateImageData(got);
-        checkErrorCode<bool, true>(valid, "failed to validate image data!");
-
-        std::cout << "OpenCL pass!" << std::endl;
-    }
-
-    void cleanup()
-    {
-        clReleaseMemObject(m_srcImage);
-        clReleaseMemObject(m_dstImage);
-        clReleaseKernel(m_kernel);
-        clReleaseProgram(m_program);
-        clReleaseCommandQueue(m_commandQueue);
-        clReleaseContext(m_context);
-    }
-
-    cl_device_id m_device;
-    cl_context m_context;
-    cl_command_queue m_commandQueue;
-    cl_program m_program;
-    cl_kernel m_kernel;
-    cl_mem m_srcImage;
-    cl_mem m_dstImage;
-};
-
-}
-
-}
+#pragma once
+
+#include <vector>
+#include <array>
+#include <mutex>
+#include <string>
+#include <iostream>
+#include <CL/cl.h>
+#include "budUtils.hpp"
+#include "budImage.hpp"
+#include "budBudget.hpp"
+#include "budMetrics.hpp"
+
+namespace bud {
+
+namespace cl {
+
+class ImageCL final : public Imagef, public Evictable {
+public:
+    explicit ImageCL(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Imagef(width, height, nrChannels, resize),
+          m_device(nullptr),
+          m_context(nullptr),
+          m_commandQueue(nullptr),
+          m_program(nullptr),
+          m_kernel(nullptr),
+          m_verticalKernel(nullptr),
+          m_srcImage(nullptr),
+          m_tmpImage(nullptr),
+          m_dstImage(nullptr) {}
+
+    ~ImageCL()
+    {
+        MemoryBudget::instance().retire(this);
+        waitInFlight();
+        if (m_context) cleanup();
+    }
+
+    // device objects live as long as the image, later frames only upload and recompute their dirty regions
+    void compute() override
+    {
+        std::lock_guard<std::mutex> use(m_useMutex);
+        waitInFlight();
+        finishFrame(submitFrame());
+    }
+
+    // the next compute() recreates the context and uploads the whole image again; skipped while another thread computes
+    bool tryEvict() override
+    {
+        std::unique_lock<std::mutex> use(m_useMutex, std::try_to_lock);
+        if (!use.owns_lock()) return false;
+        waitInFlight();
+        if (m_context) cleanup();
+        return true;
+    }
+
+protected:
+    bool deferImports() const override
+    {
+        return true;
+    }
+
+    std::unique_ptr<PendingJob> submitJob() override
+    {
+        return std::make_unique<FrameJob<ImageCL, Frame>>(*this, submitFrame());
+    }
+
+private:
+    // the kernels of one frame in flight, null events when nothing was dirty
+    struct Frame {
+        cl_event first;
+        cl_event last;
+        uint64_t submitted;
+    };
+
+    friend class FrameJob<ImageCL, Frame>;
+
+    // up to the flush of the kernels, nothing waits for the device
+    Frame submitFrame()
+    {
+        if (!m_context) {
+            StageTimer timer(Backend::OpenCL, Stage::Setup);
+            // a failed setup releases what it created, so the next compute() starts over
+            try {
+                createContext();
+                createCommandQueue();
+                createProgramAndKernel();
+                createImages();
+            } catch (...) {
+                cleanup();
+                throw;
+            }
+        }
+        MemoryBudget::instance().touch(this);
+        const std::vector<Rect> regions = takeDirtyRegions(defaultTileSize);
+        upload(regions);
+        const Frame frame = dispatch(regions);
+        Metrics::instance().jobStarted(Backend::OpenCL);
+        return frame;
+    }
+
+    // a negative status is an error, which finishFrame() reports
+    bool frameReady(const Frame& frame)
+    {
+        if (!frame.last) return true;
+        cl_int status;
+        cl_int err = clGetEventInfo(frame.last, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get event status!");
+        return status <= CL_COMPLETE;
+    }
+
+    // the blocking read of the in-order queue follows the kernels
+    void finishFrame(const Frame& frame)
+    {
+        Metrics::instance().jobEnded(Backend::OpenCL);
+        if (frame.last) {
+            cl_int err = clWaitForEvents(1, &frame.last);
+            if (err == CL_SUCCESS) recordDeviceTime(frame.first ? frame.first : frame.last, frame.last, frame.submitted);
+            if (frame.first) clReleaseEvent(frame.first);
+            clReleaseEvent(frame.last);
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to wait for event!");
+        }
+        checkAnswer();
+        Metrics::instance().jobCompleted(Backend::OpenCL, static_cast<size_t>(m_width) * m_height);
+    }
+    void createContext()
+    {
+        cl_uint numPlatforms;
+        cl_int err = clGetPlatformIDs(0, nullptr, &numPlatforms);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get platform number!");
+        std::vector<cl_platform_id> platforms(numPlatforms);
+        err = clGetPlatformIDs(platforms.size(), platforms.data(), nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get platforms!");
+
+        cl_uint numDevices;
+        err = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 0, nullptr, &numDevices);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get device number!");
+        std::vector<cl_device_id> devices(numDevices);
+        err = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, devices.size(), devices.data(), nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get devices!");
+        m_device = devices[0];
+
+        m_context = clCreateContext(nullptr, 1, &m_device, nullptr, nullptr, &err);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create context!");
+
+        cl_ulong globalMemSize;
+        err = clGetDeviceInfo(m_device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemSize), &globalMemSize, nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get device global memory size!");
+        MemoryBudget::instance().setDeviceMemory(Backend::OpenCL, static_cast<size_t>(globalMemSize));
+    }
+
+    void createCommandQueue()
+    {
+        cl_int err;
+        // profiling gives the device time of each frame
+        m_commandQueue = clCreateCommandQueue(m_context, m_device, CL_QUEUE_PROFILING_ENABLE, &err);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create command queue!");
+    }
+
+    void createProgramAndKernel()
+    {
+        const bool resize = m_resize.filter != Filter::None;
+        const std::string kernelSource = readCodeFromFile(resize ? "resize.cl" : "image.cl");
+        const char* source = kernelSource.c_str();
+        cl_int err;
+        m_program = clCreateProgramWithSource(m_context, 1, &source, nullptr, &err);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create program with source!");
+
+        std::string options;
+        if (resize) {
+            options = "-D FILTER=" + std::to_string(static_cast<int>(m_resize.filter));
+            if (m_resize.format == Format::RGBA8) options += " -D OUTPUT_SCALE=(1.0f/255.0f)";
+            if (m_resize.format == Format::RGBA16F && supportsExtension("cl_khr_fp16")) options += " -D USE_HALF";
+        }
+        err = clBuildProgram(m_program, 1, &m_device, options.c_str(), nullptr, nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to build program!");
+
+        const char* kernelName = !resize ? "image" : isSeparable(m_resize.filter) ? "resizeHorizontal" : "resize";
+        m_kernel = clCreateKernel(m_program, kernelName, &err);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create kernel!");
+
+        if (isSeparable(m_resize.filter)) {
+            m_verticalKernel = clCreateKernel(m_program, "resizeVertical", &err);
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create kernel!");
+        }
+    }
+
+    bool supportsExtension(const std::string& name)
+    {
+        size_t size;
+        cl_int err = clGetDeviceInfo(m_device, CL_DEVICE_EXTENSIONS, 0, nullptr, &size);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get device extensions!");
+        std::string extensions(size, '\0');
+        err = clGetDeviceInfo(m_device, CL_DEVICE_EXTENSIONS, size, &extensions[0], nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get device extensions!");
+        return (" " + extensions + " ").find(" " + name + " ") != std::string::npos;
+    }
+
+    void createImages()
+    {
+        bool reserved = MemoryBudget::instance().reserve(Backend::OpenCL, deviceImageBytes(), this);
+        checkErrorCode<bool, true>(reserved, "failed to reserve device memory, over budget!");
+
+        cl_mem_flags srcFlags = CL_MEM_ALLOC_HOST_PTR | CL_MEM_READ_ONLY;
+        cl_mem_flags dstFlags = CL_MEM_ALLOC_HOST_PTR | CL_MEM_WRITE_ONLY;
+        const bool halfStorage = m_resize.format == Format::RGBA16F;
+        cl_channel_type storageType = halfStorage ? CL_HALF_FLOAT : CL_FLOAT;
+        cl_image_format format{CL_RGBA, storageType};
+        cl_image_desc desc{CL_MEM_OBJECT_IMAGE2D, m_width, m_height, 0, 0, 0, 0, 0, 0, nullptr};
+        m_srcImage = createImage(srcFlags, format, desc);
+
+        if (isSeparable(m_resize.filter)) {
+            cl_image_desc tmpDesc{CL_MEM_OBJECT_IMAGE2D, m_resize.width, m_height, 0, 0, 0, 0, 0, 0, nullptr};
+            m_tmpImage = createImage(CL_MEM_READ_WRITE, format, tmpDesc);
+        }
+
+        cl_channel_type dstType = m_resize.format == Format::RGBA8 ? CL_UNORM_INT8 : storageType;
+        cl_image_format dstFormat{CL_RGBA, dstType};
+        cl_image_desc dstDesc{CL_MEM_OBJECT_IMAGE2D, m_resize.width, m_resize.height, 0, 0, 0, 0, 0, 0, nullptr};
+        m_dstImage = createImage(dstFlags, dstFormat, dstDesc);
+
+        MemoryBudget::instance().add(Backend::OpenCL, Resource::Image, deviceImageBytes(), this);
+    }
+
+    // out of memory evicts the least recently used image of another job and tries again
+    cl_mem createImage(const cl_mem_flags flags, const cl_image_format& format, const cl_image_desc& desc)
+    {
+        for (;;) {
+            cl_int err;
+            cl_mem image = clCreateImage(m_context, flags, &format, &desc, nullptr, &err);
+            const bool outOfMemory = err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES || err == CL_OUT_OF_HOST_MEMORY;
+            if (outOfMemory && MemoryBudget::instance().evictOne(Backend::OpenCL, this)) continue;
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create image!");
+            return image;
+        }
+    }
+
+    // half storage converts on the host so the upload moves half the bytes
+    void upload(const std::vector<Rect>& regions)
+    {
+        StageTimer timer(Backend::OpenCL, Stage::Upload);
+        const bool halfStorage = m_resize.format == Format::RGBA16F;
+        // float is written from m_data in place, so an import goes there first
+        if (!halfStorage) applyImport();
+        PixelBuffer<half> halfData;
+        for (const Rect& rect : regions) {
+            std::array<size_t, 3> origin{ static_cast<size_t>(rect.x), static_cast<size_t>(rect.y), 0 };
+            std::array<size_t, 3> region{ static_cast<size_t>(rect.width), static_cast<size_t>(rect.height), 1 };
+            size_t rowPitch = m_width * m_nrChannels * sizeof(float);
+            const void* hostPointer = m_data.data() + (rect.y * m_width + rect.x) * m_nrChannels;
+            if (halfStorage) {
+                rowPitch = rect.width * m_nrChannels * sizeof(half);
+                halfData.resize(rect.width * rect.height * m_nrChannels);
+                uploadRect<half>(rect, halfData.data(), rowPitch);
+                hostPointer = halfData.data();
+            }
+            // blocking, so the scratch can be reused by the next rect
+            cl_int err = clEnqueueWriteImage(m_commandQueue, m_srcImage, CL_TRUE, origin.data(), region.data(), rowPitch, 0,
+                                             hostPointer, 0, nullptr, nullptr);
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to write image!");
+        }
+        Metrics::instance().uploaded(Backend::OpenCL, uploadBytes(regions));
+    }
+
+    Frame dispatch(const std::vector<Rect>& regions)
+    {
+        StageTimer timer(Backend::OpenCL, Stage::Dispatch);
+        cl_mem dstImage = m_tmpImage ? m_tmpImage : m_dstImage;
+        cl_int err = clSetKernelArg(m_kernel, 0, sizeof(cl_mem), &m_srcImage);
+        err |= clSetKernelArg(m_kernel, 1, sizeof(cl_mem), &dstImage);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to create image!");
+
+        // the in-order queue finishes every first pass before the second pass reads the intermediate
+        Frame frame{ nullptr, nullptr, Metrics::instance().now() };
+        for (const Rect& rect : regions) enqueueRect(m_kernel, affectedRegion(rect, m_width, m_height, m_resize).pass, frame);
+
+        if (m_verticalKernel) {
+            err = clSetKernelArg(m_verticalKernel, 0, sizeof(cl_mem), &m_tmpImage);
+            err |= clSetKernelArg(m_verticalKernel, 1, sizeof(cl_mem), &m_dstImage);
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to set kernel arguments!");
+
+            for (const Rect& rect : regions) enqueueRect(m_verticalKernel, affectedRegion(rect, m_width, m_height, m_resize).dst, frame);
+        }
+        if (!frame.last) return frame;
+
+        err = clFlush(m_commandQueue);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to flush queue!");
+        return frame;
+    }
+
+    // from the start of the first kernel to the end of the last, placed at the host time of the first enqueue
+    static void recordDeviceTime(const cl_event first, const cl_event last, const uint64_t submitted)
+    {
+        cl_ulong queued, start, end;
+        cl_int err = clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, nullptr);
+        err |= clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);
+        err |= clGetEventProfilingInfo(last, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to get event profiling info!");
+        Metrics::instance().recordStage(Backend::OpenCL, Stage::Device, submitted + (start - queued), end - start);
+    }
+
+    // keeps the events of the first and the last enqueue of the frame, each with its own reference
+    void enqueueRect(const cl_kernel kernel, const Rect& rect, Frame& frame)
+    {
+        if (rect.empty()) return;
+
+        constexpr cl_uint dim = 2;
+        std::array<size_t, dim> globalOffset{ static_cast<size_t>(rect.x), static_cast<size_t>(rect.y) };
+        std::array<size_t, dim> globalSize{ static_cast<size_t>(rect.width), static_cast<size_t>(rect.height) };
+        cl_event event;
+        cl_int err = clEnqueueNDRangeKernel(m_commandQueue, kernel, dim, globalOffset.data(), globalSize.data(), nullptr, 0, nullptr, &event);
+        checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to enqueue kernel!");
+
+        if (!frame.first) {
+            frame.first = event;
+            clRetainEvent(frame.first);
+        }
+        if (frame.last) clReleaseEvent(frame.last);
+        frame.last = event;
+    }
+
+    void checkAnswer()
+    {
+        bool valid = m_resize.format == Format::RGBA8 ? readImage<uint8_t>()
+                   : m_resize.format == Format::RGBA16F ? readImage<half>() : readImage<float>();
+        checkErrorCode<bool, true>(valid, "failed to validate image data!");
+
+        if (validation()) std::cout << "OpenCL pass!" << std::endl;
+    }
+
+    template<typename U>
+    bool readImage()
+    {
+        PixelBuffer<U> got(m_resize.width * m_resize.height * m_nrChannels);
+        {
+            StageTimer timer(Backend::OpenCL, Stage::Readback);
+            std::array<size_t, 3> origin{0, 0, 0};
+            std::array<size_t, 3> region{ m_resize.width, m_resize.height, 1 };
+            cl_int err = clEnqueueReadImage(m_commandQueue, m_dstImage, CL_TRUE, origin.data(), region.data(), 0, 0, got.data(), 0, nullptr, nullptr);
+            checkErrorCode<cl_int, CL_SUCCESS>(err, "failed to read image!");
+            Metrics::instance().downloaded(Backend::OpenCL, dstImageBytes());
+        }
+
+        StageTimer timer(Backend::OpenCL, Stage::Validate);
+        return acceptImageData(got);
+    }
+
+    void cleanup()
+    {
+        if (m_srcImage) clReleaseMemObject(m_srcImage);
+        if (m_tmpImage) clReleaseMemObject(m_tmpImage);
+        if (m_dstImage) clReleaseMemObject(m_dstImage);
+        if (m_kernel) clReleaseKernel(m_kernel);
+        if (m_verticalKernel) clReleaseKernel(m_verticalKernel);
+        if (m_program) clReleaseProgram(m_program);
+        if (m_commandQueue) clReleaseCommandQueue(m_commandQueue);
+        if (m_context) clReleaseContext(m_context);
+
+        m_device = nullptr;
+        m_context = nullptr;
+        m_commandQueue = nullptr;
+        m_program = nullptr;
+        m_kernel = nullptr;
+        m_verticalKernel = nullptr;
+        m_srcImage = nullptr;
+        m_tmpImage = nullptr;
+        m_dstImage = nullptr;
+        MemoryBudget::instance().remove(this);
+        resetFrames();
+    }
+
+    cl_device_id m_device;
+    cl_context m_context;
+    cl_command_queue m_commandQueue;
+    cl_program m_program;
+    cl_kernel m_kernel;
+    cl_kernel m_verticalKernel;
+    cl_mem m_srcImage;
+    cl_mem m_tmpImage;
+    cl_mem m_dstImage;
+};
+
+}
+
+}
@@ -1,143 +1,587 @@
-#pragma once
-
-#include <GLFW/glfw3.h>
-#include <glad/glad.h>
-#include "budUtils.hpp"
-#include "budImage.hpp"
-
-namespace bud {
-
-namespace gl {
-
-class ImageGL final : public Imagef {
-public:
-    explicit ImageGL(const int width, const int height, const int nrChannels)
-        : Imagef(width, height, nrChannels),
-          m_program(0),
-          m_pipeline(0),
-          m_srcTexture(0),
-          m_dstTexture(0) {}
-
-    void compute() override
-    {
-        loadGL();
-        createPipeline();
-        createImageTextures();
-        dispatch();
-        checkAnswer();
-        cleanup();
-    }
-private:
-    static void loadGL()
-    {
-        glfwInit();
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-        GLFWwindow* window = glfwCreateWindow(800, 600, "bud", nullptr, nullptr);
-        if (!window) checkErrorCode<bool, true>(false, "failed to create window!");
-        glfwMakeContextCurrent(window);
-
-        bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-        checkErrorCode<bool, true>(loaded, "failed to load gl!");
-    }
-
-    void createPipeline()
-    {
-        const std::string shaderSource = readCodeFromFile("image.comp");
-        const char* source = shaderSource.c_str();
-        m_program = glCreateShaderProgramv(GL_COMPUTE_SHADER, 1, &source);
-
-        glGenProgramPipelines(1, &m_pipeline);
-        glUseProgramStages(m_pipeline, GL_COMPUTE_SHADER_BIT, m_program);
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create pipeline!");
-
-        // another usage
-        // GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
-        // glShaderSource(shader, 1, &source, nullptr);
-        // glCompileShader(shader);
-        // GLint success;
-        // glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        // checkErrorCode<GLint, GL_TRUE>(success, "failed to compile shader!");
-
-        // m_program = glCreateProgram();
-        // glAttachShader(m_program, shader);
-        // glLinkProgram(m_program);
-        // glGetProgramiv(m_program, GL_LINK_STATUS, &success);
-        // checkErrorCode<GLint, GL_TRUE>(success, "failed to link program!");
-
-        // glDeleteShader(shader);
-    }
-
-    void createImageTextures()
-    {
-        glActiveTexture(GL_TEXTURE0);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
-        glGenTextures(1, &m_srcTexture);
-        glBindTexture(GL_TEXTURE_2D, m_srcTexture);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, m_width, m_height);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, m_data.data());
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create image texture!");
-
-        glGenTextures(1, &m_dstTexture);
-        glBindTexture(GL_TEXTURE_2D, m_dstTexture);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, m_width, m_height);
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create image texture!");
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-
-    void dispatch()
-    {
-        // glUseProgram(m_program);
-        glBindProgramPipeline(m_pipeline);
-
-        glBindImageTexture(0, m_srcTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32F);
-        glBindImageTexture(1, m_dstTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to bind image t exture!");
-
-        glDispatchCompute(m_width, m_height, 1);
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to dispatch compute!");
-
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        glFinish();
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to finish!");
-    }
-
-    void checkAnswer()
-    {
-        std::vector<float> got(m_data.size());
-        glBindTexture(GL_TEXTURE_2D, m_dstTexture);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, got.data());
-        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to read pixels!");
-
-        bool valid = validateImageData(got);
-        checkErrorCode<bool, true>(valid, "failed to validate image data!");
-
-        std::cout << "OpenGL pass!" << std::endl;
-    }
-
-    void cleanup()
-    {
-        glDeleteTextures(1, &m_srcTexture);
-        glDeleteTextures(1, &m_dstTexture);
-        glDeleteProgramPipelines(1, &m_pipeline);
-        glDeleteProgram(m_program);
-        glfwTerminate();
-    }
-
-    GLuint m_program;
-    GLuint m_pipeline;
-    GLuint m_srcTexture;
-    GLuint m_dstTexture;
-};
-
-}
-
-}
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+#include "budUtils.hpp"
+#include "budImage.hpp"
+#include "budShader.hpp"
+#include "budBudget.hpp"
+#include "budMetrics.hpp"
+
+namespace bud {
+
+namespace gl {
+
+class ImageGL final : public Imagef, public Evictable {
+public:
+    explicit ImageGL(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Imagef(width, height, nrChannels, resize),
+          m_program(0),
+          m_verticalProgram(0),
+          m_pipeline(0),
+          m_srcTexture(0),
+          m_tmpTexture(0),
+          m_dstTexture(0),
+          m_window(nullptr),
+          m_ring{},
+          m_submitted(0),
+          m_completed(0) {}
+
+    ~ImageGL()
+    {
+        MemoryBudget::instance().retire(this);
+        waitInFlight();
+        if (m_window) cleanup();
+    }
+
+    void compute() override
+    {
+        std::lock_guard<std::mutex> use(m_useMutex);
+        waitInFlight();
+        submit();
+        complete();
+    }
+
+    // frames in flight are validated first, the next submit() recreates the context and uploads the whole image again;
+    // the window may only be destroyed by the thread that created it, and never while another thread computes
+    bool tryEvict() override
+    {
+        std::unique_lock<std::mutex> use(m_useMutex, std::try_to_lock);
+        if (!use.owns_lock()) return false;
+        if (m_window && std::this_thread::get_id() != m_windowThread) return false;
+        waitInFlight();
+        if (!m_window) return true;
+        while (m_completed != m_submitted) complete();
+        cleanup();
+        return true;
+    }
+
+protected:
+    bool deferImports() const override
+    {
+        return true;
+    }
+
+    // the context is current on one thread at a time, so it is released for the completion thread
+    std::unique_ptr<PendingJob> submitJob() override
+    {
+        submit();
+        glfwMakeContextCurrent(nullptr);
+        return std::make_unique<FrameJob<ImageGL, size_t>>(*this, m_submitted - 1);
+    }
+
+private:
+    friend class FrameJob<ImageGL, size_t>;
+
+    // submit() and complete() are private: compute() and submitJob() call them after waitInFlight(), so the context is
+    // never current here while the completion thread finishes a frame, and the ring counters move under one owner
+    // queues upload, dispatch and readback of one frame, blocks only when the ring is full
+    void submit()
+    {
+        if (!m_window) {
+            StageTimer timer(Backend::OpenGL, Stage::Setup);
+            loadGL();
+            // a failed setup releases what it created, so the next submit() starts over
+            try {
+                queryMemoryBudget();
+                // evicting another image makes its context current while releasing it
+                glfwMakeContextCurrent(m_window);
+                createPipeline();
+                createImageTextures();
+                createPixelBuffers();
+            } catch (...) {
+                cleanup();
+                throw;
+            }
+            MemoryBudget::instance().add(Backend::OpenGL, Resource::Image, deviceImageBytes(), this);
+            MemoryBudget::instance().add(Backend::OpenGL, Resource::Staging, stagingBytes(), this);
+        }
+        glfwMakeContextCurrent(m_window);
+        MemoryBudget::instance().touch(this);
+
+        if (m_submitted - m_completed == m_ring.size()) complete();
+        PixelBufferSlot& slot = m_ring[m_submitted % m_ring.size()];
+        const std::vector<Rect> regions = takeDirtyRegions(defaultTileSize);
+        upload(slot, regions);
+        // the frame is validated against what it was submitted with, later submits may change m_data;
+        // taken after the upload, which writes an import into m_data
+        if (validation()) slot.source = m_data;
+        {
+            // only queues the work, the device time comes from the timer query
+            StageTimer timer(Backend::OpenGL, Stage::Dispatch);
+            slot.submitted = Metrics::instance().now();
+            glBeginQuery(GL_TIME_ELAPSED, slot.timerQuery);
+            dispatch(regions);
+            glEndQuery(GL_TIME_ELAPSED);
+            readback(slot);
+        }
+        ++m_submitted;
+        Metrics::instance().jobStarted(Backend::OpenGL);
+    }
+
+    // waits for the oldest frame in flight and validates it
+    void complete()
+    {
+        if (m_completed == m_submitted) return;
+        glfwMakeContextCurrent(m_window);
+
+        PixelBufferSlot& slot = m_ring[m_completed % m_ring.size()];
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 4700000000);
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        ++m_completed;
+        Metrics::instance().jobEnded(Backend::OpenGL);
+        checkErrorCode<bool, true>(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED, "failed to wait for sync!");
+
+        // the fence signalled after the query ended, so the result is available without stalling
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(slot.timerQuery, GL_QUERY_RESULT, &elapsed);
+        Metrics::instance().recordStage(Backend::OpenGL, Stage::Device, slot.submitted, elapsed);
+
+        checkAnswer(slot);
+        Metrics::instance().jobCompleted(Backend::OpenGL, static_cast<size_t>(m_width) * m_height);
+    }
+
+    // takes the context for a zero timeout check of the frame's fence
+    bool frameReady(const size_t frame)
+    {
+        glfwMakeContextCurrent(m_window);
+        GLenum status = glClientWaitSync(m_ring[frame % m_ring.size()].fence, 0, 0);
+        glfwMakeContextCurrent(nullptr);
+        return status != GL_TIMEOUT_EXPIRED;
+    }
+
+    void finishFrame(const size_t frame)
+    {
+        try {
+            while (m_completed <= frame) complete();
+        } catch (...) {
+            glfwMakeContextCurrent(nullptr);
+            throw;
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+    // upload and readback buffers of one frame in flight, mapped for their whole lifetime when persistent,
+    // and the source pixels the frame was submitted with
+    struct PixelBufferSlot {
+        GLuint uploadBuffer;
+        GLuint readbackBuffer;
+        void* uploadPointer;
+        void* readbackPointer;
+        GLsync fence;
+        GLuint timerQuery;
+        uint64_t submitted;
+        PixelBuffer<float> source;
+    };
+
+    static int& liveWindows()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    void loadGL()
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        m_window = glfwCreateWindow(800, 600, "bud", nullptr, nullptr);
+        if (!m_window) checkErrorCode<bool, true>(false, "failed to create window!");
+        ++liveWindows();
+        m_windowThread = std::this_thread::get_id();
+        glfwMakeContextCurrent(m_window);
+
+        bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+        if (!loaded) {
+            glfwDestroyWindow(m_window);
+            m_window = nullptr;
+            if (--liveWindows() == 0) glfwTerminate();
+        }
+        checkErrorCode<bool, true>(loaded, "failed to load gl!");
+    }
+
+    // dedicated video memory where the driver reports it, in KiB
+    void queryMemoryBudget()
+    {
+        GLint kilobytes = 0;
+        if (GLAD_GL_NVX_gpu_memory_info) {
+            glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &kilobytes);
+        } else if (GLAD_GL_ATI_meminfo) {
+            std::array<GLint, 4> freeMemory{};
+            glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, freeMemory.data());
+            kilobytes = freeMemory[0];
+        }
+        if (kilobytes > 0) MemoryBudget::instance().setDeviceMemory(Backend::OpenGL, static_cast<size_t>(kilobytes) * 1024);
+
+        bool reserved = MemoryBudget::instance().reserve(Backend::OpenGL, deviceImageBytes() + stagingBytes(), this);
+        checkErrorCode<bool, true>(reserved, "failed to reserve device memory, over budget!");
+    }
+
+    size_t stagingBytes() const
+    {
+        return m_ring.size() * static_cast<size_t>(srcBytes() + dstBytes());
+    }
+
+    void createPipeline()
+    {
+        if (m_resize.filter != Filter::None) {
+            const char* outputScale = m_resize.format == Format::RGBA8 ? "(1.0 / 255.0)" : "1.0";
+            m_program = createResizeProgram(0, isSeparable(m_resize.filter) ? "1.0" : outputScale);
+            if (isSeparable(m_resize.filter)) m_verticalProgram = createResizeProgram(1, outputScale);
+        } else {
+            m_program = createProgram(makeImageVariant(Format::RGBA32F, defaultTileSize));
+        }
+
+        glGenProgramPipelines(1, &m_pipeline);
+        glUseProgramStages(m_pipeline, GL_COMPUTE_SHADER_BIT, m_program);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create pipeline!");
+
+        // another usage
+        // GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        // glShaderSource(shader, 1, &source, nullptr);
+        // glCompileShader(shader);
+        // GLint success;
+        // glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        // checkErrorCode<GLint, GL_TRUE>(success, "failed to compile shader!");
+
+        // m_program = glCreateProgram();
+        // glAttachShader(m_program, shader);
+        // glLinkProgram(m_program);
+        // glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+        // checkErrorCode<GLint, GL_TRUE>(success, "failed to link program!");
+
+        // glDeleteShader(shader);
+    }
+
+    // resize.comp is shared with Vulkan, which sets these through specialization constants
+    GLuint createResizeProgram(const int pass, const std::string& outputScale)
+    {
+        ShaderVariant variant = makeShaderVariant("resize.comp", defaultTileSize);
+        variant.defines["FILTER"] = std::to_string(static_cast<int>(m_resize.filter));
+        variant.defines["PASS"] = std::to_string(pass);
+        variant.defines["OUTPUT_SCALE"] = outputScale;
+        if (m_resize.format == Format::RGBA16F && GLAD_GL_AMD_gpu_shader_half_float) variant.defines["USE_FLOAT16"] = "1";
+        return createProgram(variant);
+    }
+
+    static GLuint createProgram(const ShaderVariant& variant)
+    {
+        const std::string shaderSource = ShaderCache::instance().glsl(variant);
+        const char* source = shaderSource.c_str();
+        GLuint program = glCreateShaderProgramv(GL_COMPUTE_SHADER, 1, &source);
+
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        checkErrorCode<GLint, GL_TRUE>(success, "failed to create program!");
+        return program;
+    }
+
+    void createImageTextures()
+    {
+        glActiveTexture(GL_TEXTURE0);
+
+        glGenTextures(1, &m_srcTexture);
+        glBindTexture(GL_TEXTURE_2D, m_srcTexture);
+        const GLint filter = m_resize.filter == Filter::Bilinear ? GL_LINEAR : GL_NEAREST;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexStorage2D(GL_TEXTURE_2D, 1, storageFormat(), m_width, m_height);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create image texture!");
+
+        if (isSeparable(m_resize.filter)) {
+            glGenTextures(1, &m_tmpTexture);
+            glBindTexture(GL_TEXTURE_2D, m_tmpTexture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexStorage2D(GL_TEXTURE_2D, 1, storageFormat(), m_resize.width, m_height);
+            checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create image texture!");
+        }
+
+        glGenTextures(1, &m_dstTexture);
+        glBindTexture(GL_TEXTURE_2D, m_dstTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, dstFormat(), m_resize.width, m_resize.height);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create image texture!");
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    bool halfStorage() const
+    {
+        return m_resize.format == Format::RGBA16F;
+    }
+
+    GLenum storageFormat() const
+    {
+        return halfStorage() ? GL_RGBA16F : GL_RGBA32F;
+    }
+
+    GLenum storageType() const
+    {
+        return halfStorage() ? GL_HALF_FLOAT : GL_FLOAT;
+    }
+
+    GLenum dstFormat() const
+    {
+        return m_resize.format == Format::RGBA8 ? GL_RGBA8 : storageFormat();
+    }
+
+    GLenum dstType() const
+    {
+        return m_resize.format == Format::RGBA8 ? GL_UNSIGNED_BYTE : storageType();
+    }
+
+    GLsizeiptr srcBytes() const
+    {
+        return static_cast<GLsizeiptr>(m_data.size() * texelSize());
+    }
+
+    GLsizeiptr dstBytes() const
+    {
+        const size_t size = m_resize.format == Format::RGBA8 ? sizeof(uint8_t) : halfStorage() ? sizeof(half) : sizeof(float);
+        return static_cast<GLsizeiptr>(m_resize.width * m_resize.height * m_nrChannels * size);
+    }
+
+    void createPixelBuffers()
+    {
+        const bool persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+        const GLbitfield uploadFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLbitfield readbackFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        for (PixelBufferSlot& slot : m_ring) {
+            glGenQueries(1, &slot.timerQuery);
+            glGenBuffers(1, &slot.uploadBuffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uploadBuffer);
+            if (persistent) {
+                glBufferStorage(GL_PIXEL_UNPACK_BUFFER, srcBytes(), nullptr, uploadFlags);
+                slot.uploadPointer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, srcBytes(), uploadFlags);
+            } else {
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, srcBytes(), nullptr, GL_STREAM_DRAW);
+            }
+
+            glGenBuffers(1, &slot.readbackBuffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.readbackBuffer);
+            if (persistent) {
+                glBufferStorage(GL_PIXEL_PACK_BUFFER, dstBytes(), nullptr, readbackFlags);
+                slot.readbackPointer = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, dstBytes(), readbackFlags);
+            } else {
+                glBufferData(GL_PIXEL_PACK_BUFFER, dstBytes(), nullptr, GL_STREAM_READ);
+            }
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to create pixel buffers!");
+    }
+
+    // each dirty rect keeps its place in the frame sized buffer, so one row length serves every sub-image upload
+    void upload(const PixelBufferSlot& slot, const std::vector<Rect>& regions)
+    {
+        StageTimer timer(Backend::OpenGL, Stage::Upload);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uploadBuffer);
+        if (slot.uploadPointer) {
+            writePixels(slot.uploadPointer, regions);
+        } else {
+            void* mappedPointer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, srcBytes(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            checkErrorCode<bool, true>(mappedPointer != nullptr, "failed to map pixel buffer!");
+            writePixels(mappedPointer, regions);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_srcTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, m_width);
+        for (const Rect& rect : regions) {
+            const GLintptr offset = static_cast<GLintptr>(rect.y * m_width + rect.x) * m_nrChannels * texelSize();
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_RGBA, storageType(),
+                            reinterpret_cast<const void*>(offset));
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to upload image texture!");
+        Metrics::instance().uploaded(Backend::OpenGL, uploadBytes(regions));
+    }
+
+    // half storage converts on the host so the upload moves half the bytes
+    void writePixels(void* pointer, const std::vector<Rect>& regions)
+    {
+        const size_t rowPitch = m_width * m_nrChannels * texelSize();
+        for (const Rect& rect : regions) {
+            char* first = static_cast<char*>(pointer) + rect.y * rowPitch + rect.x * m_nrChannels * texelSize();
+            if (halfStorage()) {
+                uploadRect<half>(rect, first, rowPitch);
+            } else {
+                uploadRect<float>(rect, first, rowPitch);
+            }
+        }
+    }
+
+    size_t texelSize() const
+    {
+        return halfStorage() ? sizeof(half) : sizeof(float);
+    }
+
+    void readback(PixelBufferSlot& slot)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.readbackBuffer);
+        glBindTexture(GL_TEXTURE_2D, m_dstTexture);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, dstType(), nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to read pixels!");
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+
+    void dispatch(const std::vector<Rect>& regions)
+    {
+        if (m_resize.filter != Filter::None) {
+            dispatchResize(regions);
+            return;
+        }
+
+        // glUseProgram(m_program);
+        glBindProgramPipeline(m_pipeline);
+
+        glBindImageTexture(0, m_srcTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, m_dstTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to bind image t exture!");
+
+        for (const Rect& rect : regions) dispatchRect(m_program, rect);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to dispatch compute!");
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+
+    // location 0 of image.comp and resize.comp is the origin of the dispatched rect
+    static void dispatchRect(const GLuint program, const Rect& rect)
+    {
+        glProgramUniform2i(program, 0, rect.x, rect.y);
+        glDispatchCompute(groupCount(rect.width), groupCount(rect.height), 1);
+    }
+
+    // all first passes finish before any second pass reads the intermediate
+    void dispatchResize(const std::vector<Rect>& regions)
+    {
+        glUseProgramStages(m_pipeline, GL_COMPUTE_SHADER_BIT, m_program);
+        glBindProgramPipeline(m_pipeline);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_srcTexture);
+
+        if (m_tmpTexture) {
+            glBindImageTexture(1, m_tmpTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, storageFormat());
+            for (const Rect& rect : regions) dispatchRect(m_program, affectedRegion(rect, m_width, m_height, m_resize).pass);
+            checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to dispatch compute!");
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            glUseProgramStages(m_pipeline, GL_COMPUTE_SHADER_BIT, m_verticalProgram);
+            glBindTexture(GL_TEXTURE_2D, m_tmpTexture);
+        }
+
+        glBindImageTexture(1, m_dstTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, dstFormat());
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to bind image texture!");
+
+        const GLuint program = m_tmpTexture ? m_verticalProgram : m_program;
+        for (const Rect& rect : regions) dispatchRect(program, affectedRegion(rect, m_width, m_height, m_resize).dst);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to dispatch compute!");
+
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        checkErrorCode<GLenum, GL_NO_ERROR>(glGetError(), "failed to dispatch compute!");
+    }
+
+    void checkAnswer(const PixelBufferSlot& slot)
+    {
+        bool valid = m_resize.format == Format::RGBA8 ? readPixelBuffer<uint8_t>(slot)
+                   : halfStorage() ? readPixelBuffer<half>(slot) : readPixelBuffer<float>(slot);
+        checkErrorCode<bool, true>(valid, "failed to validate image data!");
+
+        if (validation()) std::cout << "OpenGL pass!" << std::endl;
+    }
+
+    template<typename U>
+    bool readPixelBuffer(const PixelBufferSlot& slot)
+    {
+        PixelBuffer<U> got(m_resize.width * m_resize.height * m_nrChannels);
+        {
+            StageTimer timer(Backend::OpenGL, Stage::Readback);
+            if (slot.readbackPointer) {
+                std::memcpy(got.data(), slot.readbackPointer, dstBytes());
+            } else {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.readbackBuffer);
+                void* mappedPointer = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, dstBytes(), GL_MAP_READ_BIT);
+                checkErrorCode<bool, true>(mappedPointer != nullptr, "failed to map pixel buffer!");
+                std::memcpy(got.data(), mappedPointer, dstBytes());
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+            Metrics::instance().downloaded(Backend::OpenGL, dstImageBytes());
+        }
+
+        StageTimer timer(Backend::OpenGL, Stage::Validate);
+        return acceptImageData(got, slot.source);
+    }
+
+    // deleting a buffer also unmaps it
+    void cleanup()
+    {
+        glfwMakeContextCurrent(m_window);
+        for (PixelBufferSlot& slot : m_ring) {
+            if (slot.fence) glDeleteSync(slot.fence);
+            glDeleteQueries(1, &slot.timerQuery);
+            glDeleteBuffers(1, &slot.uploadBuffer);
+            glDeleteBuffers(1, &slot.readbackBuffer);
+        }
+        glDeleteTextures(1, &m_srcTexture);
+        glDeleteTextures(1, &m_tmpTexture);
+        glDeleteTextures(1, &m_dstTexture);
+        glDeleteProgramPipelines(1, &m_pipeline);
+        glDeleteProgram(m_program);
+        glDeleteProgram(m_verticalProgram);
+
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+        if (--liveWindows() == 0) glfwTerminate();
+
+        m_program = 0;
+        m_verticalProgram = 0;
+        m_pipeline = 0;
+        m_srcTexture = 0;
+        m_tmpTexture = 0;
+        m_dstTexture = 0;
+        m_ring = {};
+        // frames still in flight are dropped
+        for (; m_completed != m_submitted; ++m_completed) Metrics::instance().jobEnded(Backend::OpenGL);
+        m_submitted = 0;
+        m_completed = 0;
+        MemoryBudget::instance().remove(this);
+        resetFrames();
+    }
+
+    GLuint m_program;
+    GLuint m_verticalProgram;
+    GLuint m_pipeline;
+    GLuint m_srcTexture;
+    GLuint m_tmpTexture;
+    GLuint m_dstTexture;
+
+    GLFWwindow* m_window;
+    // the thread that created the window, the only one that may destroy it
+    std::thread::id m_windowThread;
+    std::array<PixelBufferSlot, 3> m_ring;
+    size_t m_submitted;
+    size_t m_completed;
+};
+
+}
+
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace bud {
+
+struct PoolStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // address space mapped from the OS, which is not necessarily resident
+    size_t mappedBytes = 0;
+    size_t inUseBytes = 0;
+    size_t freeBytes = 0;
+
+    double hitRate() const
+    {
+        const size_t total = hits + misses;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+// size-classed free lists of page aligned blocks for pixel data and readback scratch,
+// blocks go back to their list on release until the free lists hold maxFreeBytes, beyond that and on trim() to the OS
+class PixelPool {
+public:
+    // never destroyed, pixel buffers owned by other statics may still be released during exit
+    static PixelPool& instance()
+    {
+        static PixelPool* pool = new PixelPool();
+        return *pool;
+    }
+
+    void* allocate(const size_t bytes)
+    {
+        const size_t size = sizeClass(bytes);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.inUseBytes += size;
+
+        std::vector<void*>& blocks = m_freeBlocks[size];
+        if (!blocks.empty()) {
+            void* block = blocks.back();
+            blocks.pop_back();
+            m_stats.freeBytes -= mappingSize(size);
+            ++m_stats.hits;
+            return block;
+        }
+
+        ++m_stats.misses;
+        void* block = map(size);
+        if (!block) {
+            m_stats.inUseBytes -= size;
+            throw std::bad_alloc();
+        }
+        m_stats.mappedBytes += mappingSize(size);
+        return block;
+    }
+
+    // noexcept for PoolAllocator: a block the free list cannot take, over the cap or for lack of memory, is unmapped
+    void deallocate(void* block, const size_t bytes) noexcept
+    {
+        const size_t size = sizeClass(bytes);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.inUseBytes -= size;
+        // allocate() created the list, so no node is allocated here
+        auto blocks = m_freeBlocks.find(size);
+        if (blocks != m_freeBlocks.end() && m_stats.freeBytes + mappingSize(size) <= m_maxFreeBytes) {
+            try {
+                blocks->second.push_back(block);
+                m_stats.freeBytes += mappingSize(size);
+                return;
+            } catch (const std::bad_alloc&) {
+            }
+        }
+        release(block, size);
+    }
+
+    void trim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& blocks : m_freeBlocks) {
+            for (void* block : blocks.second) release(block, blocks.first);
+            m_stats.freeBytes -= blocks.second.size() * mappingSize(blocks.first);
+            blocks.second.clear();
+        }
+    }
+
+    // the high-water mark of the free lists, a process cycling through many sizes keeps at most this much mapped
+    // beyond what is in use; lowering it below the current free bytes trims the lists
+    void setMaxFreeBytes(const size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_maxFreeBytes = bytes;
+            if (m_stats.freeBytes <= m_maxFreeBytes) return;
+        }
+        trim();
+    }
+
+    PoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    // steps of an eighth of the enclosing power of two keep the slack of a block under 25%
+    static size_t sizeClass(const size_t bytes)
+    {
+        if (bytes <= pageSize) return pageSize;
+        size_t power = pageSize;
+        while (power < bytes) power <<= 1;
+        const size_t step = power / 8;
+        return (bytes + step - 1) / step * step;
+    }
+
+    PixelPool(const PixelPool&) = delete;
+    PixelPool& operator=(const PixelPool&) = delete;
+
+private:
+    PixelPool() = default;
+
+    static constexpr size_t pageSize = 4096;
+    static constexpr size_t defaultMaxFreeBytes = size_t(256) * 1024 * 1024;
+    static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+    static size_t mappingSize(const size_t size)
+    {
+        return size >= hugePageSize ? (size + hugePageSize - 1) / hugePageSize * hugePageSize : size;
+    }
+
+    // explicit huge pages first, then transparent huge pages, then plain pages
+    static void* map(const size_t size)
+    {
+        const size_t bytes = mappingSize(size);
+#ifdef _WIN32
+        void* block = nullptr;
+        const size_t largePage = GetLargePageMinimum();
+        if (largePage && bytes % largePage == 0) {
+            block = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        }
+        if (!block) block = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        return block;
+#else
+        void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (bytes >= hugePageSize) {
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (block == MAP_FAILED) {
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (block == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+            if (bytes >= hugePageSize) madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+        }
+        return block;
+#endif
+    }
+
+    static void unmap(void* block, const size_t size)
+    {
+#ifdef _WIN32
+        (void)size;
+        VirtualFree(block, 0, MEM_RELEASE);
+#else
+        munmap(block, mappingSize(size));
+#endif
+    }
+
+    void release(void* block, const size_t size)
+    {
+        unmap(block, size);
+        m_stats.mappedBytes -= mappingSize(size);
+    }
+
+    std::mutex m_mutex;
+    std::map<size_t, std::vector<void*>> m_freeBlocks;
+    size_t m_maxFreeBytes = defaultMaxFreeBytes;
+    PoolStats m_stats;
+};
+
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(const size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(PixelPool::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, const size_t n) noexcept
+    {
+        PixelPool::instance().deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+template<typename T>
+using PixelBuffer = std::vector<T, PoolAllocator<T>>;
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "budPool.hpp"
+#include "budResize.hpp"
+#include "budConvert.hpp"
+
+namespace bud {
+
+// workgroup edge of the compute shaders and the granularity of dirty tiles
+constexpr int defaultTileSize = 8;
+
+inline uint32_t groupCount(const int size, const int tileSize = defaultTileSize)
+{
+    return static_cast<uint32_t>((size + tileSize - 1) / tileSize);
+}
+
+struct Rect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    int right() const { return x + width; }
+    int bottom() const { return y + height; }
+};
+
+inline Rect clipRect(const Rect& rect, const int width, const int height)
+{
+    const int x = std::clamp(rect.x, 0, width);
+    const int y = std::clamp(rect.y, 0, height);
+    return { x, y, std::clamp(rect.right(), x, width) - x, std::clamp(rect.bottom(), y, height) - y };
+}
+
+// runs of differing tiles per band of tile rows, whole rows are compared first so unchanged bands cost one memcmp per row
+template<typename T>
+inline std::vector<Rect> diffRegions(const PixelBuffer<T>& previous, const PixelBuffer<T>& current, const int width, const int height,
+                                     const int nrChannels, const int tileSize)
+{
+    std::vector<Rect> regions;
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const size_t rowLength = static_cast<size_t>(width) * nrChannels;
+    std::vector<char> dirty(tilesX);
+
+    for (int band = 0; band < height; band += tileSize) {
+        std::fill(dirty.begin(), dirty.end(), 0);
+        const int bandHeight = std::min(tileSize, height - band);
+        for (int y = band; y < band + bandHeight; ++y) {
+            const T* before = previous.data() + y * rowLength;
+            const T* after = current.data() + y * rowLength;
+            if (std::memcmp(before, after, rowLength * sizeof(T)) == 0) continue;
+            for (int tile = 0; tile < tilesX; ++tile) {
+                if (dirty[tile]) continue;
+                const size_t first = static_cast<size_t>(tile) * tileSize * nrChannels;
+                const size_t length = static_cast<size_t>(std::min(tileSize, width - tile * tileSize)) * nrChannels;
+                dirty[tile] = std::memcmp(before + first, after + first, length * sizeof(T)) != 0;
+            }
+        }
+
+        for (int tile = 0; tile < tilesX;) {
+            if (!dirty[tile]) {
+                ++tile;
+                continue;
+            }
+            const int first = tile;
+            while (tile < tilesX && dirty[tile]) ++tile;
+            const Rect run{ first * tileSize, band, std::min(tile * tileSize, width) - first * tileSize, bandHeight };
+            // a run directly below one with the same columns extends it
+            auto above = std::find_if(regions.begin(), regions.end(), [&run](const Rect& rect) {
+                return rect.x == run.x && rect.width == run.width && rect.bottom() == run.y;
+            });
+            if (above != regions.end()) {
+                above->height += run.height;
+            } else {
+                regions.push_back(run);
+            }
+        }
+    }
+    return regions;
+}
+
+// rows of rect from a tightly packed frame to dst (the rect's first texel) with its own row pitch, converted to U;
+// straight into staging or mapped memory, large rects split their rows across threads
+template<typename U, typename T>
+inline void copyRect(const PixelBuffer<T>& src, const int width, const int nrChannels, const Rect& rect, void* dst, const size_t dstRowPitch)
+{
+    const size_t rowLength = static_cast<size_t>(rect.width) * nrChannels;
+    parallelFor(rect.height, parallelGrain / std::max<size_t>(rowLength, 1), [&](const size_t first, const size_t last) {
+        for (size_t y = first; y < last; ++y) {
+            const T* row = src.data() + ((rect.y + y) * width + rect.x) * nrChannels;
+            convertPixels(row, reinterpret_cast<U*>(static_cast<char*>(dst) + y * dstRowPitch), rowLength);
+        }
+    });
+}
+
+// copyRect() for a frame of 8-bit pixels: each chunk of a row is widened into frame and previous, the image's pixels
+// and its diff base, and converted from there into dst while it is still in cache, one pass instead of an import then a copy
+template<typename U>
+inline void importRect(const PixelImport& import, const int width, const Rect& rect, float* frame, float* previous, void* dst,
+                       const size_t dstRowPitch)
+{
+    constexpr size_t chunk = 1024;
+    const size_t rowLength = static_cast<size_t>(rect.width) * 4;
+    parallelFor(rect.height, parallelGrain / std::max<size_t>(rowLength, 1), [&](const size_t first, const size_t last) {
+        for (size_t y = first; y < last; ++y) {
+            const size_t row = (rect.y + y) * width + rect.x;
+            U* out = reinterpret_cast<U*>(static_cast<char*>(dst) + y * dstRowPitch);
+            for (size_t x = 0; x < static_cast<size_t>(rect.width); x += chunk) {
+                const size_t begin = row + x;
+                const size_t end = row + std::min(x + chunk, static_cast<size_t>(rect.width));
+                importRange(import.layout, import.src, import.planes, frame, begin, end, import.scale);
+                std::memcpy(previous + 4 * begin, frame + 4 * begin, (end - begin) * 4 * sizeof(float));
+                convertPixels(frame + 4 * begin, out + 4 * x, 4 * (end - begin));
+            }
+        }
+    });
+}
+
+// destination span whose filter footprint reads any source texel of [first, last), edge clamping included
+inline void affectedSpan(const int first, const int last, const int srcLength, const int dstLength, const Filter filter,
+                         int& dstFirst, int& dstLast)
+{
+    if (filter == Filter::None) {
+        dstFirst = first;
+        dstLast = last;
+        return;
+    }
+
+    const float scale = static_cast<float>(srcLength) / static_cast<float>(dstLength);
+    const float support = isSeparable(filter) ? filterRadius(filter) * std::max(scale, 1.0f) : 1.0f;
+    dstFirst = std::max(static_cast<int>(std::floor((first - 1 - support) / scale - 0.5f)) - 1, 0);
+    dstLast = std::min(static_cast<int>(std::ceil((last + support) / scale - 0.5f)) + 1, dstLength);
+}
+
+// the recompute of one dirty source rectangle: the first pass covers pass, the second (separable only) covers dst
+struct RegionPasses {
+    Rect pass;
+    Rect dst;
+};
+
+inline RegionPasses affectedRegion(const Rect& src, const int width, const int height, const Resize& resize)
+{
+    RegionPasses region;
+    int x0, x1, y0, y1;
+    affectedSpan(src.x, src.right(), width, resize.width, resize.filter, x0, x1);
+    affectedSpan(src.y, src.bottom(), height, resize.height, resize.filter, y0, y1);
+    region.dst = { x0, y0, x1 - x0, y1 - y0 };
+    region.pass = isSeparable(resize.filter) ? Rect{ x0, src.y, x1 - x0, src.height } : region.dst;
+    return region;
+}
+
+}
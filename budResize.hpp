@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "budPool.hpp"
+#include "budHalf.hpp"
+
+namespace bud {
+
+enum class Filter {
+    None = 0,
+    Nearest = 1,
+    Bilinear = 2,
+    Bicubic = 3,
+    Lanczos = 4,
+    // a tent widened by the downscale ratio, what bilinear becomes beyond 2:1 where one hardware tap would alias
+    Triangle = 5
+};
+
+enum class Format {
+    RGBA32F,
+    RGBA8,
+    RGBA16F
+};
+
+constexpr size_t channelSize(const Format format)
+{
+    return format == Format::RGBA8 ? 1 : format == Format::RGBA16F ? 2 : 4;
+}
+
+// width/height of 0 keep the source size; a narrow format is written directly by the last pass,
+// RGBA16F also stores the source and intermediate images in half
+struct Resize {
+    int width = 0;
+    int height = 0;
+    Filter filter = Filter::None;
+    Format format = Format::RGBA32F;
+};
+
+inline Resize normalizeResize(Resize resize, const int width, const int height)
+{
+    if (resize.width <= 0) resize.width = width;
+    if (resize.height <= 0) resize.height = height;
+    bool converted = resize.width != width || resize.height != height || resize.format != Format::RGBA32F;
+    if (resize.filter == Filter::None && converted) resize.filter = Filter::Nearest;
+    if (resize.filter == Filter::Bilinear && (width > 2 * resize.width || height > 2 * resize.height)) resize.filter = Filter::Triangle;
+    return resize;
+}
+
+inline bool isSeparable(const Filter filter)
+{
+    return filter == Filter::Bicubic || filter == Filter::Lanczos || filter == Filter::Triangle;
+}
+
+inline float filterRadius(const Filter filter)
+{
+    return filter == Filter::Triangle ? 1.0f : filter == Filter::Bicubic ? 2.0f : 3.0f;
+}
+
+// tent, Keys cubic (a = -0.5) and Lanczos-3, same as resize.cl and resize.comp
+inline float filterWeight(const Filter filter, float x)
+{
+    x = std::abs(x);
+    if (filter == Filter::Triangle) return std::max(1.0f - x, 0.0f);
+    if (filter == Filter::Bicubic) {
+        const float a = -0.5f;
+        if (x < 1.0f) return ((a + 2.0f) * x - (a + 3.0f)) * x * x + 1.0f;
+        if (x < 2.0f) return ((a * x - 5.0f * a) * x + 8.0f * a) * x - 4.0f * a;
+        return 0.0f;
+    }
+    if (x < 1e-6f) return 1.0f;
+    if (x >= 3.0f) return 0.0f;
+    const float px = 3.14159265f * x;
+    return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+}
+
+// hardware bilinear interpolates with 8-bit weights, narrow output rounds to the nearest step
+inline float resizeTolerance(const Resize& resize, const float epsilon)
+{
+    float tolerance = resize.filter == Filter::Bilinear ? 0.5f : epsilon;
+    if (resize.format == Format::RGBA8) tolerance += 1.0f;
+    return tolerance;
+}
+
+// half storage rounds the source and the intermediate once, every accumulated tap can round the sum again
+inline float relativeTolerance(const Resize& resize, const int width, const int height)
+{
+    if (resize.format != Format::RGBA16F) return 0.0f;
+    int roundings = 2;
+    if (isSeparable(resize.filter)) {
+        const float scale = std::max({ 1.0f, static_cast<float>(width) / resize.width, static_cast<float>(height) / resize.height });
+        roundings += 2 * (2 * static_cast<int>(std::ceil(filterRadius(resize.filter) * scale)) + 2);
+    } else if (resize.filter == Filter::Bilinear) {
+        roundings += 4;
+    }
+    return roundings * half::unitRoundoff();
+}
+
+inline int nearestCoord(const int dst, const int srcLength, const int dstLength)
+{
+    return std::min((2 * dst + 1) * srcLength / (2 * dstLength), srcLength - 1);
+}
+
+// one separable pass along x (horizontal) or y, support widens with the downscale ratio;
+// a fixed Channels replaces nrChannels so the channel loops unroll
+template<int Channels = 0>
+inline PixelBuffer<float> resamplePass(const PixelBuffer<float>& src, const int width, const int height, const int runtimeChannels,
+                                       const int dstWidth, const int dstHeight, const Filter filter, const bool horizontal)
+{
+    const int nrChannels = Channels ? Channels : runtimeChannels;
+    PixelBuffer<float> dst(dstWidth * dstHeight * nrChannels);
+    const int srcLength = horizontal ? width : height;
+    const int dstLength = horizontal ? dstWidth : dstHeight;
+    const float scale = static_cast<float>(srcLength) / static_cast<float>(dstLength);
+    const float filterScale = std::max(scale, 1.0f);
+    const float support = filterRadius(filter) * filterScale;
+
+    for (int y = 0; y < dstHeight; ++y) {
+        for (int x = 0; x < dstWidth; ++x) {
+            const float center = (static_cast<float>(horizontal ? x : y) + 0.5f) * scale;
+            const int first = static_cast<int>(std::floor(center - support));
+            const int last = static_cast<int>(std::ceil(center + support));
+            float* pixel = &dst[(y * dstWidth + x) * nrChannels];
+            float weightSum = 0.0f;
+            for (int i = first; i <= last; ++i) {
+                const float weight = filterWeight(filter, (static_cast<float>(i) + 0.5f - center) / filterScale);
+                const int s = std::clamp(i, 0, srcLength - 1);
+                const int sx = horizontal ? s : x;
+                const int sy = horizontal ? y : s;
+                for (int c = 0; c < nrChannels; ++c) pixel[c] += weight * src[(sy * width + sx) * nrChannels + c];
+                weightSum += weight;
+            }
+            for (int c = 0; c < nrChannels; ++c) pixel[c] /= weightSum;
+        }
+    }
+    return dst;
+}
+
+// host reference of the device resize, used to validate the readback; Channels as in resamplePass()
+template<int Channels = 0, typename T>
+inline PixelBuffer<float> resizeImageData(const PixelBuffer<T>& data, const int width, const int height, const int runtimeChannels,
+                                          const Resize& resize)
+{
+    const int nrChannels = Channels ? Channels : runtimeChannels;
+    PixelBuffer<float> src(data.begin(), data.end());
+    if (resize.filter == Filter::None) return src;
+
+    if (isSeparable(resize.filter)) {
+        PixelBuffer<float> tmp = resamplePass<Channels>(src, width, height, nrChannels, resize.width, height, resize.filter, true);
+        return resamplePass<Channels>(tmp, resize.width, height, nrChannels, resize.width, resize.height, resize.filter, false);
+    }
+
+    PixelBuffer<float> dst(resize.width * resize.height * nrChannels);
+    for (int y = 0; y < resize.height; ++y) {
+        for (int x = 0; x < resize.width; ++x) {
+            float* pixel = &dst[(y * resize.width + x) * nrChannels];
+            if (resize.filter == Filter::Nearest) {
+                const int sx = nearestCoord(x, width, resize.width);
+                const int sy = nearestCoord(y, height, resize.height);
+                for (int c = 0; c < nrChannels; ++c) pixel[c] = src[(sy * width + sx) * nrChannels + c];
+                continue;
+            }
+
+            const float u = (static_cast<float>(x) + 0.5f) * width / resize.width - 0.5f;
+            const float v = (static_cast<float>(y) + 0.5f) * height / resize.height - 0.5f;
+            const int x0 = static_cast<int>(std::floor(u));
+            const int y0 = static_cast<int>(std::floor(v));
+            const float fx = u - x0;
+            const float fy = v - y0;
+            const int xs[2] = { std::clamp(x0, 0, width - 1), std::clamp(x0 + 1, 0, width - 1) };
+            const int ys[2] = { std::clamp(y0, 0, height - 1), std::clamp(y0 + 1, 0, height - 1) };
+            for (int c = 0; c < nrChannels; ++c) {
+                const float top = src[(ys[0] * width + xs[0]) * nrChannels + c] * (1.0f - fx) + src[(ys[0] * width + xs[1]) * nrChannels + c] * fx;
+                const float bottom = src[(ys[1] * width + xs[0]) * nrChannels + c] * (1.0f - fx) + src[(ys[1] * width + xs[1]) * nrChannels + c] * fx;
+                pixel[c] = top * (1.0f - fy) + bottom * fy;
+            }
+        }
+    }
+    return dst;
+}
+
+}
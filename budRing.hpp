@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+#include "budUtils.hpp"
+#include "budResize.hpp"
+#include "budBudget.hpp"
+
+namespace bud {
+
+namespace ipc {
+
+// Linux only: a client and the daemon share a memfd of job slots, the client rings an eventfd doorbell
+// on submit and waits on the slot state as a futex
+
+enum class SlotState : uint32_t {
+    Free,
+    Submitted,
+    Done,
+    Failed
+};
+
+// the input of a job is width * height * nrChannels floats, the output is the destination image as read back;
+// the backends are RGBA only, so the daemon rejects any nrChannels but 4
+struct Job {
+    Backend backend = Backend::OpenCL;
+    int width = 0;
+    int height = 0;
+    int nrChannels = 4;
+    Resize resize;
+};
+
+static_assert(std::is_trivially_copyable<Job>::value, "jobs are copied through shared memory");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "slot states must be plain 32-bit words to be futexes");
+
+// state is written last by whoever hands the slot over, the rest belongs to its current owner
+struct alignas(64) SlotHeader {
+    std::atomic<uint32_t> state;
+    Job job;
+    uint64_t outputBytes;
+    char error[192];
+};
+
+struct alignas(64) RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+};
+
+constexpr uint32_t ringMagic = 0x62756472;
+constexpr uint32_t ringVersion = 1;
+constexpr uint32_t maxSlotCount = 256;
+constexpr uint64_t maxPayloadBytes = uint64_t(1) << 32;
+
+// shared futexes, the word lives in memory mapped by both processes
+inline void futexWait(std::atomic<uint32_t>& word, const uint32_t expected, const std::chrono::milliseconds timeout)
+{
+    timespec time{ static_cast<time_t>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000) * 1000000 };
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &time, nullptr, 0);
+}
+
+inline void futexWake(std::atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// the header, then per slot its header, input and output, each 64 byte aligned
+class SharedRing {
+public:
+    // a new ring in an anonymous memfd, sealed against resizing so the daemon can trust its size
+    SharedRing(const uint32_t slotCount, const size_t inputBytes, const size_t outputBytes)
+        : m_fd(-1), m_memory(nullptr), m_size(0), m_slotCount(slotCount),
+          m_inputBytes(align(inputBytes)), m_outputBytes(align(outputBytes))
+    {
+        checkErrorCode<bool, true>(slotCount > 0 && slotCount <= maxSlotCount && inputBytes <= maxPayloadBytes && outputBytes <= maxPayloadBytes,
+                                   "failed to create ring, bad size!");
+        m_size = sizeof(RingHeader) + m_slotCount * slotStride();
+
+        m_fd = memfd_create("bud-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        checkErrorCode<bool, true>(m_fd >= 0, "failed to create memfd!");
+        bool sized = ftruncate(m_fd, static_cast<off_t>(m_size)) == 0 &&
+                     fcntl(m_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0;
+        if (!sized) close(m_fd);
+        checkErrorCode<bool, true>(sized, "failed to size memfd!");
+        map();
+
+        RingHeader& ringHeader = header();
+        ringHeader.magic = ringMagic;
+        ringHeader.version = ringVersion;
+        ringHeader.slotCount = m_slotCount;
+        ringHeader.inputBytes = m_inputBytes;
+        ringHeader.outputBytes = m_outputBytes;
+    }
+
+    // maps a ring received from a client, its header is checked against the memfd once and then not read again
+    explicit SharedRing(const int fd)
+        : m_fd(fd), m_memory(nullptr), m_size(0), m_slotCount(0), m_inputBytes(0), m_outputBytes(0)
+    {
+        struct stat status{};
+        const int seals = fcntl(m_fd, F_GET_SEALS);
+        bool sealed = fstat(m_fd, &status) == 0 && seals >= 0 && (seals & F_SEAL_SHRINK) && status.st_size >= static_cast<off_t>(sizeof(RingHeader));
+        if (!sealed) close(m_fd);
+        checkErrorCode<bool, true>(sealed, "failed to attach ring, memfd not sealed!");
+        m_size = static_cast<size_t>(status.st_size);
+        map();
+
+        const RingHeader ringHeader = header();
+        bool valid = ringHeader.magic == ringMagic && ringHeader.version == ringVersion &&
+                     ringHeader.slotCount > 0 && ringHeader.slotCount <= maxSlotCount &&
+                     ringHeader.inputBytes <= maxPayloadBytes && ringHeader.inputBytes == align(ringHeader.inputBytes) &&
+                     ringHeader.outputBytes <= maxPayloadBytes && ringHeader.outputBytes == align(ringHeader.outputBytes);
+        if (valid) {
+            m_slotCount = ringHeader.slotCount;
+            m_inputBytes = ringHeader.inputBytes;
+            m_outputBytes = ringHeader.outputBytes;
+            valid = sizeof(RingHeader) + m_slotCount * slotStride() <= m_size;
+        }
+        if (!valid) release();
+        checkErrorCode<bool, true>(valid, "failed to attach ring, bad header!");
+    }
+
+    ~SharedRing() { release(); }
+
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+
+    int fd() const { return m_fd; }
+    uint32_t slotCount() const { return m_slotCount; }
+    size_t inputBytes() const { return m_inputBytes; }
+    size_t outputBytes() const { return m_outputBytes; }
+
+    SlotHeader& slot(const uint32_t index) { return *reinterpret_cast<SlotHeader*>(slotMemory(index)); }
+    void* input(const uint32_t index) { return slotMemory(index) + sizeof(SlotHeader); }
+    void* output(const uint32_t index) { return slotMemory(index) + sizeof(SlotHeader) + m_inputBytes; }
+
+private:
+    static size_t align(const size_t bytes) { return (bytes + 63) & ~size_t(63); }
+
+    size_t slotStride() const { return sizeof(SlotHeader) + m_inputBytes + m_outputBytes; }
+
+    char* slotMemory(const uint32_t index) { return static_cast<char*>(m_memory) + sizeof(RingHeader) + index * slotStride(); }
+
+    RingHeader& header() { return *static_cast<RingHeader*>(m_memory); }
+
+    void map()
+    {
+        m_memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (m_memory == MAP_FAILED) {
+            m_memory = nullptr;
+            release();
+        }
+        checkErrorCode<bool, true>(m_memory != nullptr, "failed to map ring!");
+    }
+
+    void release()
+    {
+        if (m_memory) munmap(m_memory, m_size);
+        if (m_fd >= 0) close(m_fd);
+        m_memory = nullptr;
+        m_fd = -1;
+    }
+
+    int m_fd;
+    void* m_memory;
+    size_t m_size;
+    uint32_t m_slotCount;
+    size_t m_inputBytes;
+    size_t m_outputBytes;
+};
+
+// SCM_RIGHTS hands the ring memfd and the doorbell eventfd to the daemon
+inline bool sendFds(const int socket, const std::array<int, 2>& fds)
+{
+    char byte = 0;
+    iovec data{ &byte, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* controlHeader = CMSG_FIRSTHDR(&message);
+    controlHeader->cmsg_level = SOL_SOCKET;
+    controlHeader->cmsg_type = SCM_RIGHTS;
+    controlHeader->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(controlHeader), fds.data(), sizeof(fds));
+    return sendmsg(socket, &message, MSG_NOSIGNAL) == 1;
+}
+
+// -1s unless exactly two descriptors arrived
+inline std::array<int, 2> receiveFds(const int socket)
+{
+    std::array<int, 2> fds{ -1, -1 };
+    char byte;
+    iovec data{ &byte, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(socket, &message, MSG_CMSG_CLOEXEC) != 1) return fds;
+
+    cmsghdr* controlHeader = CMSG_FIRSTHDR(&message);
+    if (!controlHeader || controlHeader->cmsg_level != SOL_SOCKET || controlHeader->cmsg_type != SCM_RIGHTS) return fds;
+    const size_t count = (controlHeader->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    std::array<int, 2> received{ -1, -1 };
+    std::memcpy(received.data(), CMSG_DATA(controlHeader), std::min(count, received.size()) * sizeof(int));
+    if (count == fds.size() && !(message.msg_flags & MSG_CTRUNC)) return received;
+    for (const int fd : received) {
+        if (fd >= 0) close(fd);
+    }
+    return fds;
+}
+
+inline sockaddr_un socketAddress(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    checkErrorCode<bool, true>(path.size() < sizeof(address.sun_path), "failed to use socket path, too long!");
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// true once the other end has closed the connection
+inline bool peerClosed(const int socket)
+{
+    pollfd descriptor{ socket, POLLIN, 0 };
+    if (poll(&descriptor, 1, 0) <= 0) return false;
+    if (descriptor.revents & (POLLHUP | POLLERR)) return true;
+    char byte;
+    return recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+// one thread drives a client: acquire() the next slot, write the pixels into it, submit(),
+// and wait() for the outputs in submission order; up to slotCount jobs are in flight
+class Client {
+public:
+    explicit Client(const std::string& socketPath, const uint32_t slotCount = 4,
+                    const size_t inputBytes = 16 << 20, const size_t outputBytes = 16 << 20)
+        : m_ring(slotCount, inputBytes, outputBytes), m_socket(-1), m_doorbell(-1), m_submitted(0), m_completed(0)
+    {
+        m_doorbell = eventfd(0, EFD_CLOEXEC);
+        checkErrorCode<bool, true>(m_doorbell >= 0, "failed to create eventfd!");
+
+        m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const sockaddr_un address = socketAddress(socketPath);
+        bool connected = m_socket >= 0 && connect(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+                         sendFds(m_socket, { m_ring.fd(), m_doorbell });
+        if (!connected) cleanup();
+        checkErrorCode<bool, true>(connected, "failed to connect to daemon!");
+    }
+
+    ~Client() { cleanup(); }
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    // the input of the next job, written in place
+    float* acquire()
+    {
+        checkErrorCode<bool, true>(m_submitted - m_completed < m_ring.slotCount(), "failed to acquire slot, ring is full!");
+        return static_cast<float*>(m_ring.input(index(m_submitted)));
+    }
+
+    size_t inputBytes() const { return m_ring.inputBytes(); }
+
+    void submit(const Job& job)
+    {
+        checkErrorCode<bool, true>(m_submitted - m_completed < m_ring.slotCount(), "failed to submit job, ring is full!");
+        SlotHeader& slot = m_ring.slot(index(m_submitted));
+        slot.job = job;
+        slot.state.store(static_cast<uint32_t>(SlotState::Submitted), std::memory_order_release);
+        ++m_submitted;
+
+        const uint64_t ring = 1;
+        checkErrorCode<bool, true>(write(m_doorbell, &ring, sizeof(ring)) == sizeof(ring), "failed to ring doorbell!");
+    }
+
+    // the output of the oldest job, valid until its slot is acquired again; the error of a failed job is thrown
+    const void* wait(size_t* outputBytes = nullptr)
+    {
+        checkErrorCode<bool, true>(m_completed < m_submitted, "failed to wait, no job submitted!");
+        const uint32_t slotIndex = index(m_completed);
+        SlotHeader& slot = m_ring.slot(slotIndex);
+        const uint32_t submitted = static_cast<uint32_t>(SlotState::Submitted);
+        while (slot.state.load(std::memory_order_acquire) == submitted) {
+            futexWait(slot.state, submitted, std::chrono::milliseconds(100));
+            if (slot.state.load(std::memory_order_acquire) == submitted && peerClosed(m_socket)) {
+                checkErrorCode<bool, true>(false, "failed to wait, daemon disconnected!");
+            }
+        }
+        ++m_completed;
+
+        if (slot.state.load(std::memory_order_relaxed) == static_cast<uint32_t>(SlotState::Failed)) {
+            throw std::runtime_error(std::string(slot.error, strnlen(slot.error, sizeof(slot.error))));
+        }
+        if (outputBytes) *outputBytes = slot.outputBytes;
+        return m_ring.output(slotIndex);
+    }
+
+private:
+    uint32_t index(const uint64_t job) const { return static_cast<uint32_t>(job % m_ring.slotCount()); }
+
+    void cleanup()
+    {
+        if (m_socket >= 0) close(m_socket);
+        if (m_doorbell >= 0) close(m_doorbell);
+        m_socket = -1;
+        m_doorbell = -1;
+    }
+
+    SharedRing m_ring;
+    int m_socket;
+    int m_doorbell;
+    uint64_t m_submitted;
+    uint64_t m_completed;
+};
+
+}
+
+}
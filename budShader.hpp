@@ -0,0 +1,124 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <shaderc/shaderc.hpp>
+#include "budUtils.hpp"
+#include "budResize.hpp"
+#include "budRegion.hpp"
+#include "budMetrics.hpp"
+
+namespace bud {
+
+// one monomorphized configuration of a compute shader, the defines are applied before compilation
+struct ShaderVariant {
+    std::string fileName;
+    std::map<std::string, std::string> defines;
+
+    std::string key() const
+    {
+        std::string key = fileName;
+        for (const auto& define : defines) key += ";" + define.first + "=" + define.second;
+        return key;
+    }
+};
+
+// every texture and view is RGBA, so the qualifier follows the device storage format alone
+inline std::string imageFormatQualifier(const Format format)
+{
+    return format == Format::RGBA8 ? "rgba8" : format == Format::RGBA16F ? "rgba16f" : "rgba32f";
+}
+
+inline ShaderVariant makeShaderVariant(const std::string& fileName, const int tileSize)
+{
+    ShaderVariant variant{ fileName, {} };
+    variant.defines["TILE_SIZE"] = std::to_string(tileSize);
+    return variant;
+}
+
+// only image.comp declares its storage format, resize.comp writes format-less so one module serves every format
+inline ShaderVariant makeImageVariant(const Format format, const int tileSize)
+{
+    ShaderVariant variant = makeShaderVariant("image.comp", tileSize);
+    variant.defines["IMAGE_FORMAT"] = imageFormatQualifier(format);
+    return variant;
+}
+
+// GLSL needs #version first, so the defines go right after it
+inline std::string injectDefines(std::string source, const std::map<std::string, std::string>& defines)
+{
+    std::string block;
+    for (const auto& define : defines) block += "#define " + define.first + " " + define.second + "\n";
+    const size_t versionEnd = source.find('\n') + 1;
+    source.insert(versionEnd, block);
+    return source;
+}
+
+// shared by the OpenGL (GLSL text) and Vulkan (SPIR-V) backends, so both always run the same source
+class ShaderCache {
+public:
+    static ShaderCache& instance()
+    {
+        static ShaderCache cache;
+        return cache;
+    }
+
+    std::string glsl(const ShaderVariant& variant)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return injectDefines(source(variant.fileName), variant.defines);
+    }
+
+    const std::vector<uint32_t>& spirv(const ShaderVariant& variant)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::string key = variant.key();
+        auto found = m_spirv.find(key);
+        Metrics::instance().shaderCacheLookup(found != m_spirv.end());
+        if (found != m_spirv.end()) {
+            ++m_hits;
+            return found->second;
+        }
+        ++m_misses;
+
+        shaderc::CompileOptions options;
+        for (const auto& define : variant.defines) options.AddMacroDefinition(define.first, define.second);
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+        options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+        shaderc::Compiler compiler;
+        shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source(variant.fileName), shaderc_glsl_compute_shader,
+                                                                         variant.fileName.c_str(), options);
+        checkErrorCode<shaderc_compilation_status, shaderc_compilation_status_success>(
+            result.GetCompilationStatus(), "failed to compile shader! " + result.GetErrorMessage());
+
+        return m_spirv.emplace(key, std::vector<uint32_t>(result.cbegin(), result.cend())).first->second;
+    }
+
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+private:
+    ShaderCache() = default;
+
+    const std::string& source(const std::string& fileName)
+    {
+        auto found = m_sources.find(fileName);
+        if (found == m_sources.end()) {
+            found = m_sources.emplace(fileName, readCodeFromFile(fileName)).first;
+            checkErrorCode<bool, false>(found->second.empty(), "failed to read shader code from file!");
+        }
+        return found->second;
+    }
+
+    std::mutex m_mutex;
+    std::map<std::string, std::string> m_sources;
+    std::map<std::string, std::vector<uint32_t>> m_spirv;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
+
+}
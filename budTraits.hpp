@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "budHalf.hpp"
+#include "budResize.hpp"
+
+namespace bud {
+
+// the channel count of images that only know it at runtime
+constexpr int dynamicChannels = 0;
+
+// interleaved keeps the channels of a pixel together, planar stores one plane per channel
+enum class Layout {
+    Interleaved,
+    Planar
+};
+
+// device format and validation tolerance of a host pixel type
+template<typename T>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<float> {
+    static constexpr Format format = Format::RGBA32F;
+    static constexpr float epsilon() { return 0.01f; }
+};
+
+template<>
+struct PixelTraits<uint8_t> {
+    static constexpr Format format = Format::RGBA8;
+    static constexpr uint8_t epsilon() { return 0; }
+};
+
+// rounding error at the top of the [64, 128) range genImageData fills
+template<>
+struct PixelTraits<half> {
+    static constexpr Format format = Format::RGBA16F;
+    static constexpr float epsilon() { return 64.0f * half::unitRoundoff(); }
+};
+
+template<typename T, int Channels, Layout L>
+struct ImageTraits {
+    static_assert(Channels >= 1 && Channels <= 4, "the device formats have one to four channels");
+
+    static constexpr int channels = Channels;
+    static constexpr Layout layout = L;
+    static constexpr Format format = PixelTraits<T>::format;
+    static constexpr size_t texelBytes = Channels * sizeof(T);
+    static constexpr size_t deviceTexelBytes = Channels * channelSize(format);
+
+    // the readback tolerance of the configuration, whatever type the host pixels are kept in
+    static constexpr float epsilon() { return static_cast<float>(PixelTraits<T>::epsilon()); }
+};
+
+// calls fn with std::integral_constant<int, nrChannels>, so a kernel runs with a compile-time channel count
+// chosen once per call instead of a runtime one in every pixel loop
+template<typename Function>
+inline decltype(auto) withChannels(const int nrChannels, Function&& fn)
+{
+    switch (nrChannels) {
+    case 1: return fn(std::integral_constant<int, 1>{});
+    case 2: return fn(std::integral_constant<int, 2>{});
+    case 3: return fn(std::integral_constant<int, 3>{});
+    case 4: return fn(std::integral_constant<int, 4>{});
+    default: return fn(std::integral_constant<int, dynamicChannels>{});
+    }
+}
+
+}
@@ -1,546 +1,1037 @@
-#pragma once
-
-#include <vector>
-#include <vulkan/vulkan.h>
-#include <budImage.hpp>
-
-namespace bud {
-
-namespace vk {
-
-class ImageVK final : public Imagef {
-public:
-    explicit ImageVK(const int width, const int height, const int nrChannels)
-        : Imagef(width, height, nrChannels),
-          m_instance(VK_NULL_HANDLE),
-          m_queueFamilyIndex(-1),
-          m_physicalDevice(VK_NULL_HANDLE),
-          m_device(VK_NULL_HANDLE),
-          m_queue(VK_NULL_HANDLE),
-          m_srcImage(VK_NULL_HANDLE),
-          m_dstImage(VK_NULL_HANDLE),
-          m_srcImageMemory(VK_NULL_HANDLE),
-          m_dstImageMemory(VK_NULL_HANDLE),
-          m_srcImageView(VK_NULL_HANDLE),
-          m_dstImageView(VK_NULL_HANDLE),
-          m_srcTransferImage(VK_NULL_HANDLE),
-          m_dstTransferImage(VK_NULL_HANDLE),
-          m_srcTransferImageMemory(VK_NULL_HANDLE),
-          m_dstTransferImageMemory(VK_NULL_HANDLE),
-          m_srcTransferImageView(VK_NULL_HANDLE),
-          m_dstTransferImageView(VK_NULL_HANDLE),
-          m_shaderModule(VK_NULL_HANDLE),
-          m_descriptorSetLayout(VK_NULL_HANDLE),
-          m_pipelineLayout(VK_NULL_HANDLE),
-          m_pipeline(VK_NULL_HANDLE),
-          m_descriptorPool(VK_NULL_HANDLE),
-          m_descriptorSet(VK_NULL_HANDLE),
-          m_commandPool(VK_NULL_HANDLE),
-          m_commandBuffer(VK_NULL_HANDLE) {}
-
-    void compute() override
-    {
-        createInstance();
-        pickPhysicalDevice();
-        createDevice();
-        createImages();
-        createTransferImages();
-        createComputePipeline();
-        createDescriptorSet();
-        createCommandBuffer();
-        dispatch();
-        checkAnswer();
-        cleanup();
-    }
-private:
-    void createInstance()
-    {
-        VkInstanceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        VkResult err = vkCreateInstance(&createInfo, nullptr, &m_instance);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create instance!");
-    }
-
-    void pickPhysicalDevice()
-    {
-        uint32_t deviceCount;
-        vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
-
-        for (auto device : devices) {
-            uint32_t queueFamiliesCount;
-            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, nullptr);
-            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamiliesCount);
-            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, queueFamilies.data());
-
-            for (uint32_t i = 0; i < queueFamiliesCount; i++) {
-                if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
-                    m_queueFamilyIndex = i;
-                    m_physicalDevice = device;
-                    return;
-                }
-            }
-        }
-
-        checkErrorCode<bool, true>(false, "failed to pick suitable physical device!");
-    }
-
-    void createDevice()
-    {
-        VkDeviceQueueCreateInfo queueCreateInfo{};
-        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
-        queueCreateInfo.queueCount = 1;
-        const float priority = 1.0f;
-        queueCreateInfo.pQueuePriorities = &priority;
-
-        VkDeviceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.queueCreateInfoCount = 1;
-        createInfo.pQueueCreateInfos = &queueCreateInfo;
-        VkResult err = vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create device!");
-
-        vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
-    }
-
-    void createImages()
-    {
-        VkImageCreateInfo imageCreateInfo{};
-        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        imageCreateInfo.extent = { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1 };
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        VkResult err = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_srcImage);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image!");
-
-        imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        err = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_dstImage);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image!");
-
-        VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &physicalDeviceMemoryProperties);
-
-        VkMemoryRequirements srcRequirements;
-        vkGetImageMemoryRequirements(m_device, m_srcImage, &srcRequirements);
-        VkMemoryRequirements dstRequirements;
-        vkGetImageMemoryRequirements(m_device, m_srcImage, &dstRequirements);
-        VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        for (uint32_t type = 0; type < physicalDeviceMemoryProperties.memoryTypeCount; type++) {
-            if ((srcRequirements.memoryTypeBits & (1 << type)) &&
-                ((physicalDeviceMemoryProperties.memoryTypes[type].propertyFlags & memoryProperties) == memoryProperties)) {;
-                VkMemoryAllocateInfo memoryAllocateInfo{};
-                memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-                memoryAllocateInfo.allocationSize = srcRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = type;
-                err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_srcImageMemory);
-                checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to allocate memory!");
-            }
-
-            if ((dstRequirements.memoryTypeBits & (1 << type)) &&
-                ((physicalDeviceMemoryProperties.memoryTypes[type].propertyFlags & memoryProperties) == memoryProperties)) {
-                VkMemoryAllocateInfo memoryAllocateInfo{};
-                memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-                memoryAllocateInfo.allocationSize = dstRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = type;
-                err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_dstImageMemory);
-                checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to allocate memory!");
-            }
-        }
-
-        if (m_srcImageMemory == VK_NULL_HANDLE || m_dstImageMemory == VK_NULL_HANDLE) checkErrorCode<bool, true>(false, "failed to create memory!");
-
-        vkBindImageMemory(m_device, m_srcImage, m_srcImageMemory, 0);
-        vkBindImageMemory(m_device, m_dstImage, m_dstImageMemory, 0);
-
-        VkImageSubresourceRange subresourceRange{};
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceRange.baseArrayLayer = 0;
-        subresourceRange.baseMipLevel = 0;
-        subresourceRange.layerCount = 1;
-        subresourceRange.levelCount = 1;
-
-        VkImageViewCreateInfo imageViewCreateInfo{};
-        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        imageViewCreateInfo.image = m_srcImage;
-        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        imageViewCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.subresourceRange = subresourceRange;
-        err = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_srcImageView);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image view!");
-
-        imageViewCreateInfo.image = m_dstImage;
-        err = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_dstImageView);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image view!");
-    }
-
-    void createTransferImages()
-    {
-        VkImageCreateInfo imageCreateInfo{};
-        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        imageCreateInfo.extent = { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1 };
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
-        imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        VkResult err = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_srcTransferImage);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image!");
-
-        imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        err = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_dstTransferImage);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image!");
-
-        VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &physicalDeviceMemoryProperties);
-
-        VkMemoryRequirements srcRequirements;
-        vkGetImageMemoryRequirements(m_device, m_srcTransferImage, &srcRequirements);
-        VkMemoryRequirements dstRequirements;
-        vkGetImageMemoryRequirements(m_device, m_dstTransferImage, &dstRequirements);
-        VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        for (uint32_t type = 0; type < physicalDeviceMemoryProperties.memoryTypeCount; type++) {
-            if ((srcRequirements.memoryTypeBits & (1 << type)) &&
-                ((physicalDeviceMemoryProperties.memoryTypes[type].propertyFlags & memoryProperties) == memoryProperties)) {
-                ;
-                VkMemoryAllocateInfo memoryAllocateInfo{};
-                memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-                memoryAllocateInfo.allocationSize = srcRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = type;
-                err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_srcTransferImageMemory);
-                checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to allocate memory!");
-            }
-
-            if ((dstRequirements.memoryTypeBits & (1 << type)) &&
-                ((physicalDeviceMemoryProperties.memoryTypes[type].propertyFlags & memoryProperties) == memoryProperties)) {
-                VkMemoryAllocateInfo memoryAllocateInfo{};
-                memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-                memoryAllocateInfo.allocationSize = dstRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = type;
-                err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &m_dstTransferImageMemory);
-                checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to allocate memory!");
-            }
-        }
-
-        if (m_srcTransferImageMemory == VK_NULL_HANDLE || m_dstTransferImageMemory == VK_NULL_HANDLE) checkErrorCode<bool, true>(false, "failed to create memory!");
-
-        vkBindImageMemory(m_device, m_srcTransferImage, m_srcTransferImageMemory, 0);
-        vkBindImageMemory(m_device, m_dstTransferImage, m_dstTransferImageMemory, 0);
-
-        VkImageSubresourceRange subresourceRange{};
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceRange.baseArrayLayer = 0;
-        subresourceRange.baseMipLevel = 0;
-        subresourceRange.layerCount = 1;
-        subresourceRange.levelCount = 1;
-
-        VkImageViewCreateInfo imageViewCreateInfo{};
-        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        imageViewCreateInfo.image = m_srcTransferImage;
-        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        imageViewCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.subresourceRange = subresourceRange;
-        err = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_srcTransferImageView);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image view!");
-
-        imageViewCreateInfo.image = m_dstImage;
-        err = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_dstTransferImageView);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image view!");
-
-        void* mappedPointer;
-        err = vkMapMemory(m_device, m_srcTransferImageMemory, 0, m_data.size() * sizeof(float), 0, &mappedPointer);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to map memory!");
-
-        std::memcpy(mappedPointer, m_data.data(), m_data.size() * sizeof(float));
-
-        VkMappedMemoryRange memoryRange{};
-        memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        memoryRange.memory = m_srcTransferImageMemory;
-        memoryRange.offset = 0;
-        memoryRange.size = m_data.size() * sizeof(float);
-        err = vkFlushMappedMemoryRanges(m_device, 1, &memoryRange);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to flush memory!");
-
-        vkUnmapMemory(m_device, m_srcTransferImageMemory);
-    }
-
-    void createComputePipeline()
-    {
-        const std::vector<char> spirvSource = readSpirvFromFile("comp.spv");
-        checkErrorCode<bool, false>(spirvSource.empty(), "failed to read shader code from file!");
-
-        VkShaderModuleCreateInfo shaderModuleCreateInfo{};
-        shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        shaderModuleCreateInfo.codeSize = spirvSource.size();
-        shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(spirvSource.data());
-        VkResult err = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &m_shaderModule);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create shader module!");
-
-        VkPipelineShaderStageCreateInfo shaderStageCreateInfo{};
-        shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-        shaderStageCreateInfo.module = m_shaderModule;
-        shaderStageCreateInfo.pName = "main";
-
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
-        for (uint32_t i = 0; i < 2; i++) {
-            bindings[i].binding = i;
-            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-            bindings[i].descriptorCount = 1;
-            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-            bindings[i].pImmutableSamplers = nullptr;
-        }
-
-        VkDescriptorSetLayoutCreateInfo descSetLayoutCreateInfo{};
-        descSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        descSetLayoutCreateInfo.bindingCount = 2;
-        descSetLayoutCreateInfo.pBindings = bindings.data();
-        err = vkCreateDescriptorSetLayout(m_device, &descSetLayoutCreateInfo, nullptr, &m_descriptorSetLayout);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor set layout!");
-
-        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutCreateInfo.setLayoutCount = 1;
-        pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
-        err = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create pipeline layout!");
-
-        VkComputePipelineCreateInfo pipelineCreateInfo{};
-        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-        pipelineCreateInfo.stage = shaderStageCreateInfo;
-        pipelineCreateInfo.layout = m_pipelineLayout;
-        err = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create pipeline!");
-    }
-
-    void createDescriptorSet()
-    {
-        VkDescriptorPoolCreateInfo descPoolCreateInfo{};
-        descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        descPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-        descPoolCreateInfo.maxSets = 2;
-        descPoolCreateInfo.poolSizeCount = 1;
-        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE , 1 };
-        descPoolCreateInfo.pPoolSizes = &poolSize;
-        VkResult err = vkCreateDescriptorPool(m_device, &descPoolCreateInfo, nullptr, &m_descriptorPool);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor pool!");
-
-        VkDescriptorSetAllocateInfo descSetAllocateInfo{};
-        descSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        descSetAllocateInfo.descriptorPool = m_descriptorPool;
-        descSetAllocateInfo.descriptorSetCount = 1;
-        descSetAllocateInfo.pSetLayouts = &m_descriptorSetLayout;
-        err = vkAllocateDescriptorSets(m_device, &descSetAllocateInfo, &m_descriptorSet);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor set!");
-
-        std::array<VkDescriptorImageInfo, 2> descriptorImageInfos{};
-        descriptorImageInfos[0].imageView = m_srcImageView;
-        descriptorImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        descriptorImageInfos[0].sampler = VK_NULL_HANDLE;
-        descriptorImageInfos[1].imageView = m_dstImageView;
-        descriptorImageInfos[1].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        descriptorImageInfos[1].sampler = VK_NULL_HANDLE;
-
-        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
-        for (uint32_t i = 0; i < 2; i++) {
-            writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            writeDescriptorSets[i].dstSet = m_descriptorSet;
-            writeDescriptorSets[i].dstBinding = i;
-            writeDescriptorSets[i].descriptorCount = 1;
-            writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-            writeDescriptorSets[i].pImageInfo = &descriptorImageInfos[i];
-        }
-        vkUpdateDescriptorSets(m_device, 2, writeDescriptorSets.data(), 0, nullptr);
-    }
-
-    void createCommandBuffer()
-    {
-        VkCommandPoolCreateInfo commandPoolCreateInfo{};
-        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
-        commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-        VkResult err = vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_commandPool);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create command pool!");
-
-        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.commandPool = m_commandPool;
-        commandBufferAllocateInfo.commandBufferCount = 1;
-        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        err = vkAllocateCommandBuffers(m_device, &commandBufferAllocateInfo, &m_commandBuffer);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create command buffer!");
-    }
-
-    void dispatch()
-    {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        VkResult err = vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to begin command buffer!");
-
-        VkImageCopy region{};
-        region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-        region.srcOffset = { 0, 0, 0 };
-        region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-        region.dstOffset = { 0, 0, 0 };
-        region.extent = {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1};
-        vkCmdCopyImage(m_commandBuffer, m_srcTransferImage, VK_IMAGE_LAYOUT_UNDEFINED, m_srcImage, VK_IMAGE_LAYOUT_UNDEFINED, 1, &region);
-
-        VkMemoryBarrier preMemoryBarrier{};
-        preMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-        preMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        preMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        VkImageMemoryBarrier preImageMemoryBarrier{};
-        preImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        preImageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        preImageMemoryBarrier.srcQueueFamilyIndex = m_queueFamilyIndex;
-        preImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        preImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        preImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        preImageMemoryBarrier.image = m_srcImage;
-        preImageMemoryBarrier.dstQueueFamilyIndex = m_queueFamilyIndex;
-        preImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT,
-                             1, &preMemoryBarrier, 0, nullptr, 1, &preImageMemoryBarrier);
-
-        vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
-        vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
-        vkCmdDispatch(m_commandBuffer, static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1);
-
-        VkMemoryBarrier postMemoryBarrier{};
-        postMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-        postMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        postMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-        VkImageMemoryBarrier postImageMemoryBarrier{};
-        postImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        postImageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        postImageMemoryBarrier.srcQueueFamilyIndex = m_queueFamilyIndex;
-        postImageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        postImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        postImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        postImageMemoryBarrier.image = m_dstImage;
-        postImageMemoryBarrier.dstQueueFamilyIndex = m_queueFamilyIndex;
-        postImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_DEPENDENCY_BY_REGION_BIT,
-                             1, &postMemoryBarrier, 0, nullptr, 1, &postImageMemoryBarrier);
-
-        vkCmdCopyImage(m_commandBuffer, m_dstImage, VK_IMAGE_LAYOUT_UNDEFINED, m_dstTransferImage, VK_IMAGE_LAYOUT_UNDEFINED, 1, &region);
-
-        err = vkEndCommandBuffer(m_commandBuffer);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to end command buffer!");
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_commandBuffer;
-
-        VkFenceCreateInfo fenceCreateInfo{};
-        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        VkFence fence;
-        err = vkCreateFence(m_device, &fenceCreateInfo, nullptr, &fence);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create fence!");
-
-        err = vkQueueSubmit(m_queue, 1, &submitInfo, fence);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to submit queue!");
-
-        vkWaitForFences(m_device, 1, &fence, VK_TRUE, 4700000000);
-        vkDestroyFence(m_device, fence, nullptr);
-
-        err = vkQueueWaitIdle(m_queue);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to wait for queue finish!");
-    }
-
-    void checkAnswer()
-    {
-        std::vector<float> got(m_data.size());
-        void* mappedPointer = got.data();
-        VkResult err = vkMapMemory(m_device, m_dstTransferImageMemory, 0, got.size() * sizeof(float), 0, &mappedPointer);
-        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to map memory!");
-
-        std::memcpy(got.data(), mappedPointer, got.size() * sizeof(float));
-
-        vkUnmapMemory(m_device, m_dstTransferImageMemory);
-
-        bool valid = validateImageData(got);
-        checkErrorCode<bool, true>(valid, "failed to validate image data!");
-
-        std::cout << "Vulkan pass!" << std::endl;
-    }
-
-    void cleanup()
-    {
-        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
-        vkFreeDescriptorSets(m_device, m_descriptorPool, 1, &m_descriptorSet);
-        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
-        vkDestroyPipeline(m_device, m_pipeline, nullptr);
-        vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-        vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
-        vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
-        vkDestroyImageView(m_device, m_srcImageView, nullptr);
-        vkDestroyImageView(m_device, m_dstImageView, nullptr);
-        vkFreeMemory(m_device, m_srcImageMemory, nullptr);
-        vkFreeMemory(m_device, m_dstImageMemory, nullptr);
-        vkDestroyImage(m_device, m_srcImage, nullptr);
-        vkDestroyImage(m_device, m_dstImage, nullptr);
-        vkDestroyDevice(m_device, nullptr);
-        vkDestroyInstance(m_instance, nullptr);
-    }
-
-    VkInstance m_instance;
-    uint32_t m_queueFamilyIndex;
-    VkPhysicalDevice m_physicalDevice;
-    VkDevice m_device;
-    VkQueue m_queue;
-
-    VkImage m_srcImage;
-    VkImage m_dstImage;
-    VkDeviceMemory m_srcImageMemory;
-    VkDeviceMemory m_dstImageMemory;
-    VkImageView m_srcImageView;
-    VkImageView m_dstImageView;
-
-    VkImage m_srcTransferImage;
-    VkImage m_dstTransferImage;
-    VkDeviceMemory m_srcTransferImageMemory;
-    VkDeviceMemory m_dstTransferImageMemory;
-    VkImageView m_srcTransferImageView;
-    VkImageView m_dstTransferImageView;
-
-    VkShaderModule m_shaderModule;
-    VkDescriptorSetLayout m_descriptorSetLayout;
-    VkPipelineLayout m_pipelineLayout;
-    VkPipeline m_pipeline;
-
-    VkDescriptorPool m_descriptorPool;
-    VkDescriptorSet m_descriptorSet;
-
-    VkCommandPool m_commandPool;
-    VkCommandBuffer m_commandBuffer;
-};
-
-}
-
-}
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <array>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <vulkan/vulkan.h>
+#include <budImage.hpp>
+#include <budShader.hpp>
+#include <budBudget.hpp>
+#include <budMetrics.hpp>
+
+namespace bud {
+
+namespace vk {
+
+class ImageVK final : public Imagef, public Evictable {
+public:
+    explicit ImageVK(const int width, const int height, const int nrChannels, const Resize& resize = Resize{})
+        : Imagef(width, height, nrChannels, resize),
+          m_instance(VK_NULL_HANDLE),
+          m_queueFamilyIndex(-1),
+          m_float16(false),
+          m_physicalDevice(VK_NULL_HANDLE),
+          m_device(VK_NULL_HANDLE),
+          m_queue(VK_NULL_HANDLE),
+          m_srcImage(VK_NULL_HANDLE),
+          m_tmpImage(VK_NULL_HANDLE),
+          m_dstImage(VK_NULL_HANDLE),
+          m_srcImageMemory(VK_NULL_HANDLE),
+          m_tmpImageMemory(VK_NULL_HANDLE),
+          m_dstImageMemory(VK_NULL_HANDLE),
+          m_srcImageView(VK_NULL_HANDLE),
+          m_tmpImageView(VK_NULL_HANDLE),
+          m_dstImageView(VK_NULL_HANDLE),
+          m_sampler(VK_NULL_HANDLE),
+          m_srcTransferImage(VK_NULL_HANDLE),
+          m_dstTransferImage(VK_NULL_HANDLE),
+          m_srcTransferImageMemory(VK_NULL_HANDLE),
+          m_dstTransferImageMemory(VK_NULL_HANDLE),
+          m_srcTransferImageView(VK_NULL_HANDLE),
+          m_dstTransferImageView(VK_NULL_HANDLE),
+          m_srcTransferPointer(nullptr),
+          m_dstTransferPointer(nullptr),
+          m_shaderModule(VK_NULL_HANDLE),
+          m_descriptorSetLayout(VK_NULL_HANDLE),
+          m_pipelineLayout(VK_NULL_HANDLE),
+          m_pipeline(VK_NULL_HANDLE),
+          m_verticalPipeline(VK_NULL_HANDLE),
+          m_descriptorPool(VK_NULL_HANDLE),
+          m_descriptorSet(VK_NULL_HANDLE),
+          m_verticalDescriptorSet(VK_NULL_HANDLE),
+          m_commandPool(VK_NULL_HANDLE),
+          m_commandBuffer(VK_NULL_HANDLE),
+          m_fullFrameCommandBuffer(VK_NULL_HANDLE),
+          m_fence(VK_NULL_HANDLE),
+          m_queryPool(VK_NULL_HANDLE),
+          m_timestampValidBits(0),
+          m_timestampPeriod(0.0f) {}
+
+    ~ImageVK()
+    {
+        MemoryBudget::instance().retire(this);
+        waitInFlight();
+        if (m_device != VK_NULL_HANDLE) cleanup();
+    }
+
+    // device objects live as long as the image, later frames only upload and recompute their dirty regions
+    void compute() override
+    {
+        std::lock_guard<std::mutex> use(m_useMutex);
+        waitInFlight();
+        finishFrame(submitFrame());
+    }
+
+    // the next compute() recreates the device and uploads the whole image again; skipped while another thread computes
+    bool tryEvict() override
+    {
+        std::unique_lock<std::mutex> use(m_useMutex, std::try_to_lock);
+        if (!use.owns_lock()) return false;
+        waitInFlight();
+        if (m_device != VK_NULL_HANDLE) cleanup();
+        return true;
+    }
+
+protected:
+    bool deferImports() const override
+    {
+        return true;
+    }
+
+    std::unique_ptr<PendingJob> submitJob() override
+    {
+        return std::make_unique<FrameJob<ImageVK, Frame>>(*this, submitFrame());
+    }
+
+private:
+    // the submit of one frame in flight, m_fence signals its end
+    struct Frame {
+        uint64_t submitted;
+    };
+
+    friend class FrameJob<ImageVK, Frame>;
+
+    // up to the queue submit, nothing waits for the device
+    Frame submitFrame()
+    {
+        if (m_device == VK_NULL_HANDLE) {
+            StageTimer timer(Backend::Vulkan, Stage::Setup);
+            createInstance();
+            // a failed setup releases what it created, so the next compute() starts over
+            try {
+                pickPhysicalDevice();
+                queryMemoryBudget();
+                createDevice();
+                createImages();
+                createTransferImages();
+                createSampler();
+                createComputePipeline();
+                createDescriptorSet();
+                createCommandBuffer();
+                createQueryPool();
+                transitionImages();
+                recordCommandBuffer(m_fullFrameCommandBuffer, 0, { Rect{ 0, 0, m_width, m_height } });
+            } catch (...) {
+                cleanup();
+                throw;
+            }
+            // the allocations may come in under the reserved estimate
+            MemoryBudget::instance().settle(this);
+        }
+        MemoryBudget::instance().touch(this);
+        const std::vector<Rect> regions = takeDirtyRegions(defaultTileSize);
+        writeTransferImage(regions);
+        const Frame frame = dispatch(regions);
+        Metrics::instance().jobStarted(Backend::Vulkan);
+        return frame;
+    }
+
+    // errors such as a lost device count as ready, finishFrame() reports them
+    bool frameReady(const Frame&)
+    {
+        return vkGetFenceStatus(m_device, m_fence) != VK_NOT_READY;
+    }
+
+    void finishFrame(const Frame& frame)
+    {
+        Metrics::instance().jobEnded(Backend::Vulkan);
+        VkResult err = vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, 4700000000);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to wait for fence!");
+        recordDeviceTime(frame.submitted);
+
+        checkAnswer();
+        Metrics::instance().jobCompleted(Backend::Vulkan, static_cast<size_t>(m_width) * m_height);
+    }
+
+    void createInstance()
+    {
+        // 1.1 for vkGetPhysicalDeviceFeatures2
+        VkApplicationInfo applicationInfo{};
+        applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &applicationInfo;
+        VkResult err = vkCreateInstance(&createInfo, nullptr, &m_instance);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create instance!");
+    }
+
+    void pickPhysicalDevice()
+    {
+        uint32_t deviceCount;
+        vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+
+        for (auto device : devices) {
+            uint32_t queueFamiliesCount;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamiliesCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, queueFamilies.data());
+
+            for (uint32_t i = 0; i < queueFamiliesCount; i++) {
+                if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                    m_queueFamilyIndex = i;
+                    m_timestampValidBits = queueFamilies[i].timestampValidBits;
+                    m_physicalDevice = device;
+                    return;
+                }
+            }
+        }
+
+        checkErrorCode<bool, true>(false, "failed to pick suitable physical device!");
+    }
+
+    // the budget of this process on the device local heaps, or their size without VK_EXT_memory_budget
+    void queryMemoryBudget()
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        const bool budget = supportsExtension("VK_EXT_memory_budget");
+        if (budget) memoryProperties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &memoryProperties);
+
+        size_t bytes = 0;
+        const VkPhysicalDeviceMemoryProperties& properties = memoryProperties.memoryProperties;
+        for (uint32_t heap = 0; heap < properties.memoryHeapCount; ++heap) {
+            if (!(properties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+            bytes += budget ? budgetProperties.heapBudget[heap] : properties.memoryHeaps[heap].size;
+        }
+        MemoryBudget::instance().setDeviceMemory(Backend::Vulkan, bytes);
+
+        // the two linear transfer images are the staging memory
+        bool reserved = MemoryBudget::instance().reserve(Backend::Vulkan, deviceImageBytes() + srcImageBytes() + dstImageBytes(), this);
+        checkErrorCode<bool, true>(reserved, "failed to reserve device memory, over budget!");
+    }
+
+    void createDevice()
+    {
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+        queueCreateInfo.queueCount = 1;
+        const float priority = 1.0f;
+        queueCreateInfo.pQueuePriorities = &priority;
+
+        // resize.comp writes its destination without a format qualifier so one shader serves every output format
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+        VkPhysicalDeviceFeatures features{};
+        if (m_resize.filter != Filter::None) {
+            checkErrorCode<VkBool32, VK_TRUE>(supportedFeatures.shaderStorageImageWriteWithoutFormat, "failed to find storage image write without format!");
+            features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+        }
+
+        // half storage always works, half arithmetic only where shaderFloat16 is supported
+        VkPhysicalDeviceShaderFloat16Int8Features float16Features{};
+        float16Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+        std::vector<const char*> extensions;
+        if (m_resize.format == Format::RGBA16F && supportsExtension("VK_KHR_shader_float16_int8")) {
+            VkPhysicalDeviceFeatures2 supportedFeatures2{};
+            supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supportedFeatures2.pNext = &float16Features;
+            vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures2);
+            m_float16 = float16Features.shaderFloat16 == VK_TRUE;
+            float16Features.pNext = nullptr;
+            float16Features.shaderInt8 = VK_FALSE;
+            if (m_float16) extensions.push_back("VK_KHR_shader_float16_int8");
+        }
+
+        VkDeviceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = m_float16 ? &float16Features : nullptr;
+        createInfo.queueCreateInfoCount = 1;
+        createInfo.pQueueCreateInfos = &queueCreateInfo;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+        createInfo.pEnabledFeatures = &features;
+        VkResult err = vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create device!");
+
+        vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+    }
+
+    bool supportsExtension(const std::string& name)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+        return std::any_of(extensions.begin(), extensions.end(), [&name](const VkExtensionProperties& extension) {
+            return name == extension.extensionName;
+        });
+    }
+
+    void createImages()
+    {
+        const VkExtent3D srcExtent{ static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1 };
+        const VkExtent3D dstExtent{ static_cast<uint32_t>(m_resize.width), static_cast<uint32_t>(m_resize.height), 1 };
+        const VkImageUsageFlags sampled = m_resize.filter != Filter::None ? VK_IMAGE_USAGE_SAMPLED_BIT : 0;
+
+        createImage(srcExtent, storageFormat(), VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | sampled, VK_IMAGE_LAYOUT_UNDEFINED, m_srcImage);
+        allocateImageMemory(m_srcImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_srcImageMemory);
+        createImageView(m_srcImage, storageFormat(), m_srcImageView);
+
+        if (isSeparable(m_resize.filter)) {
+            const VkExtent3D tmpExtent{ static_cast<uint32_t>(m_resize.width), static_cast<uint32_t>(m_height), 1 };
+            createImage(tmpExtent, storageFormat(), VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, m_tmpImage);
+            allocateImageMemory(m_tmpImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_tmpImageMemory);
+            createImageView(m_tmpImage, storageFormat(), m_tmpImageView);
+        }
+
+        createImage(dstExtent, dstFormat(), VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_UNDEFINED, m_dstImage);
+        allocateImageMemory(m_dstImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_dstImageMemory);
+        createImageView(m_dstImage, dstFormat(), m_dstImageView);
+    }
+
+    void createTransferImages()
+    {
+        const VkExtent3D srcExtent{ static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1 };
+        const VkExtent3D dstExtent{ static_cast<uint32_t>(m_resize.width), static_cast<uint32_t>(m_resize.height), 1 };
+        const VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        // preinitialized keeps the host writes below across the first layout transition
+        createImage(srcExtent, storageFormat(), VK_IMAGE_TILING_LINEAR,
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED, m_srcTransferImage);
+        allocateImageMemory(m_srcTransferImage, memoryProperties, m_srcTransferImageMemory);
+        createImageView(m_srcTransferImage, storageFormat(), m_srcTransferImageView);
+
+        createImage(dstExtent, dstFormat(), VK_IMAGE_TILING_LINEAR,
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_LAYOUT_UNDEFINED, m_dstTransferImage);
+        allocateImageMemory(m_dstTransferImage, memoryProperties, m_dstTransferImageMemory);
+        createImageView(m_dstTransferImage, dstFormat(), m_dstTransferImageView);
+
+        // host coherent memory stays mapped until vkFreeMemory
+        VkResult err = vkMapMemory(m_device, m_srcTransferImageMemory, 0, VK_WHOLE_SIZE, 0, &m_srcTransferPointer);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to map memory!");
+        err = vkMapMemory(m_device, m_dstTransferImageMemory, 0, VK_WHOLE_SIZE, 0, &m_dstTransferPointer);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to map memory!");
+    }
+
+    // half storage converts on the host so the upload moves half the bytes
+    void writeTransferImage(const std::vector<Rect>& regions)
+    {
+        StageTimer timer(Backend::Vulkan, Stage::Upload);
+        VkImageSubresource subresource{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+        VkSubresourceLayout layout;
+        vkGetImageSubresourceLayout(m_device, m_srcTransferImage, &subresource, &layout);
+
+        const bool halfStorage = m_resize.format == Format::RGBA16F;
+        const size_t texelSize = m_nrChannels * (halfStorage ? sizeof(half) : sizeof(float));
+        for (const Rect& rect : regions) {
+            char* first = static_cast<char*>(m_srcTransferPointer) + layout.offset + rect.y * layout.rowPitch + rect.x * texelSize;
+            if (halfStorage) {
+                uploadRect<half>(rect, first, layout.rowPitch);
+            } else {
+                uploadRect<float>(rect, first, layout.rowPitch);
+            }
+        }
+
+        VkMappedMemoryRange memoryRange{};
+        memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        memoryRange.memory = m_srcTransferImageMemory;
+        memoryRange.offset = 0;
+        memoryRange.size = VK_WHOLE_SIZE;
+        VkResult err = vkFlushMappedMemoryRanges(m_device, 1, &memoryRange);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to flush memory!");
+        Metrics::instance().uploaded(Backend::Vulkan, uploadBytes(regions));
+    }
+
+    VkFormat storageFormat() const
+    {
+        return m_resize.format == Format::RGBA16F ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+
+    VkFormat dstFormat() const
+    {
+        return m_resize.format == Format::RGBA8 ? VK_FORMAT_R8G8B8A8_UNORM : storageFormat();
+    }
+
+    void createImage(const VkExtent3D extent, const VkFormat format, const VkImageTiling tiling, const VkImageUsageFlags usage,
+                     const VkImageLayout initialLayout, VkImage& image)
+    {
+        VkImageCreateInfo imageCreateInfo{};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = format;
+        imageCreateInfo.extent = extent;
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = tiling;
+        imageCreateInfo.usage = usage;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = initialLayout;
+        VkResult err = vkCreateImage(m_device, &imageCreateInfo, nullptr, &image);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image!");
+    }
+
+    void allocateImageMemory(const VkImage image, const VkMemoryPropertyFlags memoryProperties, VkDeviceMemory& memory)
+    {
+        VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &physicalDeviceMemoryProperties);
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device, image, &requirements);
+        for (uint32_t type = 0; type < physicalDeviceMemoryProperties.memoryTypeCount; type++) {
+            if ((requirements.memoryTypeBits & (1 << type)) &&
+                ((physicalDeviceMemoryProperties.memoryTypes[type].propertyFlags & memoryProperties) == memoryProperties)) {
+                VkMemoryAllocateInfo memoryAllocateInfo{};
+                memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                memoryAllocateInfo.allocationSize = requirements.size;
+                memoryAllocateInfo.memoryTypeIndex = type;
+                VkResult err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &memory);
+                // out of memory evicts the least recently used image of another job and tries again
+                while ((err == VK_ERROR_OUT_OF_DEVICE_MEMORY || err == VK_ERROR_OUT_OF_HOST_MEMORY) &&
+                       MemoryBudget::instance().evictOne(Backend::Vulkan, this)) {
+                    err = vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &memory);
+                }
+                checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to allocate memory!");
+
+                const bool staging = memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+                MemoryBudget::instance().add(Backend::Vulkan, staging ? Resource::Staging : Resource::Image, requirements.size, this);
+                break;
+            }
+        }
+
+        if (memory == VK_NULL_HANDLE) checkErrorCode<bool, true>(false, "failed to create memory!");
+
+        vkBindImageMemory(m_device, image, memory, 0);
+    }
+
+    void createImageView(const VkImage image, const VkFormat format, VkImageView& imageView)
+    {
+        VkImageSubresourceRange subresourceRange{};
+        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceRange.baseArrayLayer = 0;
+        subresourceRange.baseMipLevel = 0;
+        subresourceRange.layerCount = 1;
+        subresourceRange.levelCount = 1;
+
+        VkImageViewCreateInfo imageViewCreateInfo{};
+        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        imageViewCreateInfo.image = image;
+        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCreateInfo.format = format;
+        imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.subresourceRange = subresourceRange;
+        VkResult err = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &imageView);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create image view!");
+    }
+
+    void createSampler()
+    {
+        if (m_resize.filter == Filter::None) return;
+
+        const bool linear = m_resize.filter == Filter::Bilinear;
+        if (linear) {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(m_physicalDevice, storageFormat(), &formatProperties);
+            bool filterable = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            checkErrorCode<bool, true>(filterable, "failed to find linear filtering for float images!");
+        }
+
+        VkSamplerCreateInfo samplerCreateInfo{};
+        samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerCreateInfo.magFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        samplerCreateInfo.minFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.maxLod = 0.0f;
+        samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+        VkResult err = vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_sampler);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create sampler!");
+    }
+
+    void createComputePipeline()
+    {
+        const bool resize = m_resize.filter != Filter::None;
+        // the filter, pass and output scale of resize.comp stay specialization constants of a single module
+        ShaderVariant variant = resize ? makeShaderVariant("resize.comp", defaultTileSize) : makeImageVariant(Format::RGBA32F, defaultTileSize);
+        if (m_float16) variant.defines["USE_FLOAT16"] = "1";
+        const std::vector<uint32_t>& spirvSource = ShaderCache::instance().spirv(variant);
+
+        VkShaderModuleCreateInfo shaderModuleCreateInfo{};
+        shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shaderModuleCreateInfo.codeSize = spirvSource.size() * sizeof(uint32_t);
+        shaderModuleCreateInfo.pCode = spirvSource.data();
+        VkResult err = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &m_shaderModule);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create shader module!");
+
+        VkPipelineShaderStageCreateInfo shaderStageCreateInfo{};
+        shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStageCreateInfo.module = m_shaderModule;
+        shaderStageCreateInfo.pName = "main";
+
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        for (uint32_t i = 0; i < 2; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = resize && i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            bindings[i].pImmutableSamplers = nullptr;
+        }
+
+        VkDescriptorSetLayoutCreateInfo descSetLayoutCreateInfo{};
+        descSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descSetLayoutCreateInfo.bindingCount = 2;
+        descSetLayoutCreateInfo.pBindings = bindings.data();
+        err = vkCreateDescriptorSetLayout(m_device, &descSetLayoutCreateInfo, nullptr, &m_descriptorSetLayout);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor set layout!");
+
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = 1;
+        pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+        const VkPushConstantRange pushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof(int32_t) };
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        err = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create pipeline layout!");
+
+        if (resize) {
+            const float outputScale = m_resize.format == Format::RGBA8 ? 1.0f / 255.0f : 1.0f;
+            createResizePipeline(shaderStageCreateInfo, 0, isSeparable(m_resize.filter) ? 1.0f : outputScale, m_pipeline);
+            if (isSeparable(m_resize.filter)) createResizePipeline(shaderStageCreateInfo, 1, outputScale, m_verticalPipeline);
+            return;
+        }
+
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage = shaderStageCreateInfo;
+        pipelineCreateInfo.layout = m_pipelineLayout;
+        err = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create pipeline!");
+    }
+
+    // FILTER, PASS and OUTPUT_SCALE specialization constants of resize.comp
+    void createResizePipeline(VkPipelineShaderStageCreateInfo shaderStageCreateInfo, const int pass, const float outputScale, VkPipeline& pipeline)
+    {
+        struct {
+            int32_t filter;
+            int32_t pass;
+            float outputScale;
+        } constants{ static_cast<int32_t>(m_resize.filter), pass, outputScale };
+
+        std::array<VkSpecializationMapEntry, 3> mapEntries{};
+        mapEntries[0] = { 0, 0, sizeof(int32_t) };
+        mapEntries[1] = { 1, sizeof(int32_t), sizeof(int32_t) };
+        mapEntries[2] = { 2, 2 * sizeof(int32_t), sizeof(float) };
+
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+        specializationInfo.pMapEntries = mapEntries.data();
+        specializationInfo.dataSize = sizeof(constants);
+        specializationInfo.pData = &constants;
+        shaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
+
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage = shaderStageCreateInfo;
+        pipelineCreateInfo.layout = m_pipelineLayout;
+        VkResult err = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create pipeline!");
+    }
+
+    void createDescriptorSet()
+    {
+        if (m_resize.filter != Filter::None) {
+            createResizeDescriptorSets();
+            return;
+        }
+
+        // one set with the source and destination storage images, freed with the pool
+        VkDescriptorPoolCreateInfo descPoolCreateInfo{};
+        descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descPoolCreateInfo.maxSets = 1;
+        descPoolCreateInfo.poolSizeCount = 1;
+        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 };
+        descPoolCreateInfo.pPoolSizes = &poolSize;
+        VkResult err = vkCreateDescriptorPool(m_device, &descPoolCreateInfo, nullptr, &m_descriptorPool);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor pool!");
+
+        VkDescriptorSetAllocateInfo descSetAllocateInfo{};
+        descSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descSetAllocateInfo.descriptorPool = m_descriptorPool;
+        descSetAllocateInfo.descriptorSetCount = 1;
+        descSetAllocateInfo.pSetLayouts = &m_descriptorSetLayout;
+        err = vkAllocateDescriptorSets(m_device, &descSetAllocateInfo, &m_descriptorSet);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor set!");
+
+        std::array<VkDescriptorImageInfo, 2> descriptorImageInfos{};
+        descriptorImageInfos[0].imageView = m_srcImageView;
+        descriptorImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfos[0].sampler = VK_NULL_HANDLE;
+        descriptorImageInfos[1].imageView = m_dstImageView;
+        descriptorImageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfos[1].sampler = VK_NULL_HANDLE;
+
+        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+        for (uint32_t i = 0; i < 2; i++) {
+            writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSets[i].dstSet = m_descriptorSet;
+            writeDescriptorSets[i].dstBinding = i;
+            writeDescriptorSets[i].descriptorCount = 1;
+            writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writeDescriptorSets[i].pImageInfo = &descriptorImageInfos[i];
+        }
+        vkUpdateDescriptorSets(m_device, 2, writeDescriptorSets.data(), 0, nullptr);
+    }
+
+    void createResizeDescriptorSets()
+    {
+        // a sampled source and a storage destination per pass, freed with the pool
+        const uint32_t setCount = m_tmpImageView != VK_NULL_HANDLE ? 2 : 1;
+        VkDescriptorPoolCreateInfo descPoolCreateInfo{};
+        descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descPoolCreateInfo.maxSets = setCount;
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount };
+        poolSizes[1] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount };
+        descPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descPoolCreateInfo.pPoolSizes = poolSizes.data();
+        VkResult err = vkCreateDescriptorPool(m_device, &descPoolCreateInfo, nullptr, &m_descriptorPool);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor pool!");
+
+        if (m_tmpImageView != VK_NULL_HANDLE) {
+            writeResizeDescriptorSet(m_srcImageView, m_tmpImageView, m_descriptorSet);
+            writeResizeDescriptorSet(m_tmpImageView, m_dstImageView, m_verticalDescriptorSet);
+        } else {
+            writeResizeDescriptorSet(m_srcImageView, m_dstImageView, m_descriptorSet);
+        }
+    }
+
+    void writeResizeDescriptorSet(const VkImageView src, const VkImageView dst, VkDescriptorSet& descriptorSet)
+    {
+        VkDescriptorSetAllocateInfo descSetAllocateInfo{};
+        descSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descSetAllocateInfo.descriptorPool = m_descriptorPool;
+        descSetAllocateInfo.descriptorSetCount = 1;
+        descSetAllocateInfo.pSetLayouts = &m_descriptorSetLayout;
+        VkResult err = vkAllocateDescriptorSets(m_device, &descSetAllocateInfo, &descriptorSet);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create descriptor set!");
+
+        std::array<VkDescriptorImageInfo, 2> descriptorImageInfos{};
+        descriptorImageInfos[0].imageView = src;
+        descriptorImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfos[0].sampler = m_sampler;
+        descriptorImageInfos[1].imageView = dst;
+        descriptorImageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfos[1].sampler = VK_NULL_HANDLE;
+
+        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+        for (uint32_t i = 0; i < 2; i++) {
+            writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSets[i].dstSet = descriptorSet;
+            writeDescriptorSets[i].dstBinding = i;
+            writeDescriptorSets[i].descriptorCount = 1;
+            writeDescriptorSets[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writeDescriptorSets[i].pImageInfo = &descriptorImageInfos[i];
+        }
+        vkUpdateDescriptorSets(m_device, 2, writeDescriptorSets.data(), 0, nullptr);
+    }
+
+    void createCommandBuffer()
+    {
+        VkCommandPoolCreateInfo commandPoolCreateInfo{};
+        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+        commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VkResult err = vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_commandPool);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create command pool!");
+
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.commandPool = m_commandPool;
+        commandBufferAllocateInfo.commandBufferCount = 2;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        std::array<VkCommandBuffer, 2> commandBuffers{};
+        err = vkAllocateCommandBuffers(m_device, &commandBufferAllocateInfo, commandBuffers.data());
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create command buffer!");
+        m_commandBuffer = commandBuffers[0];
+        m_fullFrameCommandBuffer = commandBuffers[1];
+
+        VkFenceCreateInfo fenceCreateInfo{};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        err = vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_fence);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create fence!");
+    }
+
+    // moves every image into the general layout once, so the frames record no first-use transitions
+    void transitionImages()
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VkResult err = vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to begin command buffer!");
+
+        imageBarrier(m_commandBuffer, m_srcTransferImage, VK_IMAGE_LAYOUT_PREINITIALIZED, 0, 0,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        for (const VkImage image : { m_srcImage, m_tmpImage, m_dstImage, m_dstTransferImage }) {
+            if (image == VK_NULL_HANDLE) continue;
+            imageBarrier(m_commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        }
+
+        err = vkEndCommandBuffer(m_commandBuffer);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to end command buffer!");
+        submit(m_commandBuffer);
+        err = vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, 4700000000);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to wait for fence!");
+    }
+
+    // queues without timestamp support leave the device time out
+    void createQueryPool()
+    {
+        if (!m_timestampValidBits) return;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        m_timestampPeriod = properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo queryPoolCreateInfo{};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCreateInfo.queryCount = 2;
+        VkResult err = vkCreateQueryPool(m_device, &queryPoolCreateInfo, nullptr, &m_queryPool);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to create query pool!");
+    }
+
+    // a whole frame resubmits the command buffer recorded at setup, dirty regions record their own;
+    // the fence signals the end of the frame and the next one is submitted only after it
+    Frame dispatch(const std::vector<Rect>& regions)
+    {
+        StageTimer timer(Backend::Vulkan, Stage::Dispatch);
+        VkCommandBuffer commandBuffer = m_fullFrameCommandBuffer;
+        if (regions.size() != 1 || regions[0].width != m_width || regions[0].height != m_height) {
+            commandBuffer = m_commandBuffer;
+            recordCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, regions);
+        }
+
+        const Frame frame{ Metrics::instance().now() };
+        submit(commandBuffer);
+        return frame;
+    }
+
+    void recordCommandBuffer(const VkCommandBuffer commandBuffer, const VkCommandBufferUsageFlags flags, const std::vector<Rect>& regions)
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = flags;
+        VkResult err = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to begin command buffer!");
+
+        recordFrame(commandBuffer, regions);
+
+        err = vkEndCommandBuffer(commandBuffer);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to end command buffer!");
+    }
+
+    void submit(const VkCommandBuffer commandBuffer)
+    {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        VkResult err = vkResetFences(m_device, 1, &m_fence);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to reset fence!");
+        err = vkQueueSubmit(m_queue, 1, &submitInfo, m_fence);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to submit queue!");
+    }
+
+    // the two timestamps around the dispatches, placed at the host time of the submit
+    void recordDeviceTime(const uint64_t submitted)
+    {
+        if (m_queryPool == VK_NULL_HANDLE) return;
+
+        std::array<uint64_t, 2> timestamps{};
+        VkResult err = vkGetQueryPoolResults(m_device, m_queryPool, 0, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+                                             VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        checkErrorCode<VkResult, VK_SUCCESS>(err, "failed to get query pool results!");
+
+        const uint64_t mask = m_timestampValidBits >= 64 ? ~0ull : (1ull << m_timestampValidBits) - 1;
+        const uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+        Metrics::instance().recordStage(Backend::Vulkan, Stage::Device, submitted, static_cast<uint64_t>(ticks * static_cast<double>(m_timestampPeriod)));
+    }
+
+    // images are in the general layout since transitionImages(), so every frame records the same barriers and
+    // the contents outside the dirty regions are kept
+    void recordFrame(const VkCommandBuffer commandBuffer, const std::vector<Rect>& regions)
+    {
+        const VkExtent3D dstExtent{ static_cast<uint32_t>(m_resize.width), static_cast<uint32_t>(m_resize.height), 1 };
+
+        imageBarrier(commandBuffer, m_srcTransferImage, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_HOST_WRITE_BIT,
+                     VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        imageBarrier(commandBuffer, m_srcImage, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        copyRects(commandBuffer, m_srcTransferImage, m_srcImage, regions);
+
+        imageBarrier(commandBuffer, m_srcImage, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        if (m_tmpImage != VK_NULL_HANDLE) {
+            imageBarrier(commandBuffer, m_tmpImage, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+        imageBarrier(commandBuffer, m_dstImage, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        // the first timestamp waits for the upload copy, the second for the last dispatch
+        if (m_queryPool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(commandBuffer, m_queryPool, 0, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, m_queryPool, 0);
+        }
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+        for (const Rect& rect : regions) recordRect(commandBuffer, affectedRegion(rect, m_width, m_height, m_resize).pass);
+
+        if (m_tmpImage != VK_NULL_HANDLE) {
+            imageBarrier(commandBuffer, m_tmpImage, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_verticalPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_verticalDescriptorSet, 0, nullptr);
+            for (const Rect& rect : regions) recordRect(commandBuffer, affectedRegion(rect, m_width, m_height, m_resize).dst);
+        }
+        if (m_queryPool != VK_NULL_HANDLE) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_queryPool, 1);
+
+        imageBarrier(commandBuffer, m_dstImage, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        imageBarrier(commandBuffer, m_dstTransferImage, VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        copyImage(commandBuffer, m_dstImage, m_dstTransferImage, dstExtent);
+
+        imageBarrier(commandBuffer, m_dstTransferImage, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    }
+
+    // the origin push constant of image.comp and resize.comp
+    void recordRect(const VkCommandBuffer commandBuffer, const Rect& rect)
+    {
+        if (rect.empty()) return;
+        const std::array<int32_t, 2> origin{ rect.x, rect.y };
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(origin), origin.data());
+        vkCmdDispatch(commandBuffer, groupCount(rect.width), groupCount(rect.height), 1);
+    }
+
+    // every image stays in the general layout once it has been transitioned
+    void imageBarrier(const VkCommandBuffer commandBuffer, const VkImage image, const VkImageLayout oldLayout, const VkAccessFlags srcAccessMask, const VkAccessFlags dstAccessMask,
+                      const VkPipelineStageFlags srcStageMask, const VkPipelineStageFlags dstStageMask)
+    {
+        VkImageMemoryBarrier imageMemoryBarrier{};
+        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.srcAccessMask = srcAccessMask;
+        imageMemoryBarrier.dstAccessMask = dstAccessMask;
+        imageMemoryBarrier.oldLayout = oldLayout;
+        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageMemoryBarrier.image = image;
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+    }
+
+    void copyRects(const VkCommandBuffer commandBuffer, const VkImage src, const VkImage dst, const std::vector<Rect>& regions)
+    {
+        std::vector<VkImageCopy> copyRegions(regions.size());
+        for (size_t i = 0; i < regions.size(); ++i) {
+            const Rect& rect = regions[i];
+            copyRegions[i].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            copyRegions[i].srcOffset = { rect.x, rect.y, 0 };
+            copyRegions[i].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            copyRegions[i].dstOffset = { rect.x, rect.y, 0 };
+            copyRegions[i].extent = { static_cast<uint32_t>(rect.width), static_cast<uint32_t>(rect.height), 1 };
+        }
+        if (copyRegions.empty()) return;
+        vkCmdCopyImage(commandBuffer, src, VK_IMAGE_LAYOUT_GENERAL, dst, VK_IMAGE_LAYOUT_GENERAL,
+                       static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    }
+
+    void copyImage(const VkCommandBuffer commandBuffer, const VkImage src, const VkImage dst, const VkExtent3D extent)
+    {
+        VkImageCopy region{};
+        region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.srcOffset = { 0, 0, 0 };
+        region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.dstOffset = { 0, 0, 0 };
+        region.extent = extent;
+        vkCmdCopyImage(commandBuffer, src, VK_IMAGE_LAYOUT_GENERAL, dst, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+    }
+
+    void checkAnswer()
+    {
+        bool valid = m_resize.format == Format::RGBA8 ? readTransferImage<uint8_t>()
+                   : m_resize.format == Format::RGBA16F ? readTransferImage<half>() : readTransferImage<float>();
+        checkErrorCode<bool, true>(valid, "failed to validate image data!");
+
+        if (validation()) std::cout << "Vulkan pass!" << std::endl;
+    }
+
+    template<typename U>
+    bool readTransferImage()
+    {
+        PixelBuffer<U> got(m_resize.width * m_resize.height * m_nrChannels);
+        {
+            StageTimer timer(Backend::Vulkan, Stage::Readback);
+            VkImageSubresource subresource{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+            VkSubresourceLayout layout;
+            vkGetImageSubresourceLayout(m_device, m_dstTransferImage, &subresource, &layout);
+
+            const size_t rowSize = m_resize.width * m_nrChannels * sizeof(U);
+            for (int y = 0; y < m_resize.height; ++y) {
+                std::memcpy(reinterpret_cast<char*>(got.data()) + y * rowSize,
+                            static_cast<const char*>(m_dstTransferPointer) + layout.offset + y * layout.rowPitch, rowSize);
+            }
+            Metrics::instance().downloaded(Backend::Vulkan, dstImageBytes());
+        }
+
+        StageTimer timer(Backend::Vulkan, Stage::Validate);
+        return acceptImageData(got);
+    }
+
+    void cleanup()
+    {
+        // a setup that failed before the device was created has only the instance
+        if (m_device != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+            vkDestroyFence(m_device, m_fence, nullptr);
+            vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+            vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+            vkDestroyPipeline(m_device, m_pipeline, nullptr);
+            vkDestroyPipeline(m_device, m_verticalPipeline, nullptr);
+            vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+            vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
+            vkDestroySampler(m_device, m_sampler, nullptr);
+            vkDestroyImageView(m_device, m_srcImageView, nullptr);
+            vkDestroyImageView(m_device, m_tmpImageView, nullptr);
+            vkDestroyImageView(m_device, m_dstImageView, nullptr);
+            vkDestroyImageView(m_device, m_srcTransferImageView, nullptr);
+            vkDestroyImageView(m_device, m_dstTransferImageView, nullptr);
+            vkDestroyImage(m_device, m_srcImage, nullptr);
+            vkDestroyImage(m_device, m_tmpImage, nullptr);
+            vkDestroyImage(m_device, m_dstImage, nullptr);
+            vkDestroyImage(m_device, m_srcTransferImage, nullptr);
+            vkDestroyImage(m_device, m_dstTransferImage, nullptr);
+            vkFreeMemory(m_device, m_srcImageMemory, nullptr);
+            vkFreeMemory(m_device, m_tmpImageMemory, nullptr);
+            vkFreeMemory(m_device, m_dstImageMemory, nullptr);
+            vkFreeMemory(m_device, m_srcTransferImageMemory, nullptr);
+            vkFreeMemory(m_device, m_dstTransferImageMemory, nullptr);
+            vkDestroyDevice(m_device, nullptr);
+        }
+        vkDestroyInstance(m_instance, nullptr);
+
+        m_instance = VK_NULL_HANDLE;
+        m_physicalDevice = VK_NULL_HANDLE;
+        m_device = VK_NULL_HANDLE;
+        m_queue = VK_NULL_HANDLE;
+        m_srcImage = VK_NULL_HANDLE;
+        m_tmpImage = VK_NULL_HANDLE;
+        m_dstImage = VK_NULL_HANDLE;
+        m_srcImageMemory = VK_NULL_HANDLE;
+        m_tmpImageMemory = VK_NULL_HANDLE;
+        m_dstImageMemory = VK_NULL_HANDLE;
+        m_srcImageView = VK_NULL_HANDLE;
+        m_tmpImageView = VK_NULL_HANDLE;
+        m_dstImageView = VK_NULL_HANDLE;
+        m_sampler = VK_NULL_HANDLE;
+        m_srcTransferImage = VK_NULL_HANDLE;
+        m_dstTransferImage = VK_NULL_HANDLE;
+        m_srcTransferImageMemory = VK_NULL_HANDLE;
+        m_dstTransferImageMemory = VK_NULL_HANDLE;
+        m_srcTransferImageView = VK_NULL_HANDLE;
+        m_dstTransferImageView = VK_NULL_HANDLE;
+        m_srcTransferPointer = nullptr;
+        m_dstTransferPointer = nullptr;
+        m_shaderModule = VK_NULL_HANDLE;
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+        m_pipelineLayout = VK_NULL_HANDLE;
+        m_pipeline = VK_NULL_HANDLE;
+        m_verticalPipeline = VK_NULL_HANDLE;
+        m_descriptorPool = VK_NULL_HANDLE;
+        m_descriptorSet = VK_NULL_HANDLE;
+        m_verticalDescriptorSet = VK_NULL_HANDLE;
+        m_commandPool = VK_NULL_HANDLE;
+        m_commandBuffer = VK_NULL_HANDLE;
+        m_fullFrameCommandBuffer = VK_NULL_HANDLE;
+        m_fence = VK_NULL_HANDLE;
+        m_queryPool = VK_NULL_HANDLE;
+        m_timestampValidBits = 0;
+        m_timestampPeriod = 0.0f;
+        m_float16 = false;
+        MemoryBudget::instance().remove(this);
+        resetFrames();
+    }
+
+    VkInstance m_instance;
+    uint32_t m_queueFamilyIndex;
+    bool m_float16;
+    VkPhysicalDevice m_physicalDevice;
+    VkDevice m_device;
+    VkQueue m_queue;
+
+    VkImage m_srcImage;
+    VkImage m_tmpImage;
+    VkImage m_dstImage;
+    VkDeviceMemory m_srcImageMemory;
+    VkDeviceMemory m_tmpImageMemory;
+    VkDeviceMemory m_dstImageMemory;
+    VkImageView m_srcImageView;
+    VkImageView m_tmpImageView;
+    VkImageView m_dstImageView;
+    VkSampler m_sampler;
+
+    VkImage m_srcTransferImage;
+    VkImage m_dstTransferImage;
+    VkDeviceMemory m_srcTransferImageMemory;
+    VkDeviceMemory m_dstTransferImageMemory;
+    VkImageView m_srcTransferImageView;
+    VkImageView m_dstTransferImageView;
+    void* m_srcTransferPointer;
+    void* m_dstTransferPointer;
+
+    VkShaderModule m_shaderModule;
+    VkDescriptorSetLayout m_descriptorSetLayout;
+    VkPipelineLayout m_pipelineLayout;
+    VkPipeline m_pipeline;
+    VkPipeline m_verticalPipeline;
+
+    VkDescriptorPool m_descriptorPool;
+    VkDescriptorSet m_descriptorSet;
+    VkDescriptorSet m_verticalDescriptorSet;
+
+    VkCommandPool m_commandPool;
+    VkCommandBuffer m_commandBuffer;
+    VkCommandBuffer m_fullFrameCommandBuffer;
+    VkFence m_fence;
+    VkQueryPool m_queryPool;
+    uint32_t m_timestampValidBits;
+    float m_timestampPeriod;
+};
+
+}
+
+}
@@ -1,2 +0,0 @@
-C:\sdk\VulkanSDK\1.2.141.2\Bin\glslangValidator.exe -V image.comp
-pause
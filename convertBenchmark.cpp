@@ -0,0 +1,134 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <functional>
+#include <budConvert.hpp>
+#include <budRegion.hpp>
+
+// Host-only: g++ -std=c++17 -O2 -march=native -pthread -I. convertBenchmark.cpp -o convertBenchmark
+
+namespace {
+
+constexpr size_t pixels = 1920 * 1080;
+constexpr int repeats = 20;
+
+// GB/s over the bytes read and written per run
+double throughput(const size_t bytes, const std::function<void()>& run)
+{
+    run();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(bytes) * repeats / elapsed.count() / 1e9;
+}
+
+// the vector kernel split across threads the way copyRect() splits rows
+template<typename Kernel>
+void threaded(const size_t count, Kernel kernel)
+{
+    bud::parallelFor(count, bud::parallelGrain, [&](const size_t first, const size_t last) { kernel(first, last - first); });
+}
+
+void report(const char* name, const size_t bytes, const std::function<void()>& scalar, const std::function<void()>& vector,
+            const std::function<void()>& parallel, const bool same)
+{
+    std::printf("%-22s scalar %6.2f GB/s, simd %6.2f GB/s, simd+threads %6.2f GB/s%s\n", name, throughput(bytes, scalar),
+                throughput(bytes, vector), throughput(bytes, parallel), same ? "" : "  MISMATCH");
+}
+
+}
+
+int main()
+{
+    const size_t elements = pixels * 4;
+    std::vector<uint8_t> bytes(elements);
+    std::vector<uint8_t> rgb(pixels * 3);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 131 + (i >> 9));
+    for (size_t i = 0; i < rgb.size(); ++i) rgb[i] = static_cast<uint8_t>(i * 17 + (i >> 7));
+    std::vector<float> floats(elements);
+    for (size_t i = 0; i < floats.size(); ++i) floats[i] = static_cast<float>(i % 4099) * 0.0625f - 3.0f;
+
+    std::vector<float> floatOut(elements), floatRef(elements);
+    std::vector<uint8_t> byteOut(elements), byteRef(elements);
+    std::vector<bud::half> halfOut(elements), halfRef(elements);
+    std::vector<bud::half> halves(elements);
+    bud::scalar::f32ToF16(floats.data(), halves.data(), elements);
+
+    report("u8 -> f32 normalize", elements * 5,
+           [&] { bud::scalar::u8ToF32(bytes.data(), floatRef.data(), elements, 1.0f / 255.0f); },
+           [&] { bud::u8ToF32(bytes.data(), floatOut.data(), elements, 1.0f / 255.0f); },
+           [&] { threaded(elements, [&](size_t i, size_t n) { bud::u8ToF32(bytes.data() + i, floatOut.data() + i, n, 1.0f / 255.0f); }); },
+           floatOut == floatRef);
+
+    report("f32 -> u8", elements * 5,
+           [&] { bud::scalar::f32ToU8(floats.data(), byteRef.data(), elements, 40.0f); },
+           [&] { bud::f32ToU8(floats.data(), byteOut.data(), elements, 40.0f); },
+           [&] { threaded(elements, [&](size_t i, size_t n) { bud::f32ToU8(floats.data() + i, byteOut.data() + i, n, 40.0f); }); },
+           byteOut == byteRef);
+
+    report("RGB8 -> RGBA8", pixels * 7,
+           [&] { bud::scalar::rgbToRgba(rgb.data(), byteRef.data(), pixels, 255); },
+           [&] { bud::rgbToRgba(rgb.data(), byteOut.data(), pixels, 255); },
+           [&] { threaded(pixels, [&](size_t i, size_t n) { bud::rgbToRgba(rgb.data() + 3 * i, byteOut.data() + 4 * i, n, 255); }); },
+           byteOut == byteRef);
+
+    report("BGRA8 -> RGBA8", pixels * 8,
+           [&] { bud::scalar::swapRedBlue(bytes.data(), byteRef.data(), pixels); },
+           [&] { bud::swapRedBlue(bytes.data(), byteOut.data(), pixels); },
+           [&] { threaded(pixels, [&](size_t i, size_t n) { bud::swapRedBlue(bytes.data() + 4 * i, byteOut.data() + 4 * i, n); }); },
+           byteOut == byteRef);
+
+    const uint8_t* bytePlanes[4] = { bytes.data(), bytes.data() + pixels, bytes.data() + 2 * pixels, bytes.data() + 3 * pixels };
+    report("planar u8 -> RGBA8", pixels * 8,
+           [&] { bud::scalar::planarToInterleaved(bytePlanes, 4, byteRef.data(), pixels); },
+           [&] { bud::planarToInterleaved(bytePlanes, 4, byteOut.data(), pixels); },
+           [&] { threaded(pixels, [&](size_t i, size_t n) {
+               const uint8_t* planes[4] = { bytePlanes[0] + i, bytePlanes[1] + i, bytePlanes[2] + i, bytePlanes[3] + i };
+               bud::planarToInterleaved(planes, 4, byteOut.data() + 4 * i, n);
+           }); },
+           byteOut == byteRef);
+
+    float* floatPlanes[4] = { floatOut.data(), floatOut.data() + pixels, floatOut.data() + 2 * pixels, floatOut.data() + 3 * pixels };
+    float* refPlanes[4] = { floatRef.data(), floatRef.data() + pixels, floatRef.data() + 2 * pixels, floatRef.data() + 3 * pixels };
+    report("RGBA f32 -> planar", elements * 8,
+           [&] { bud::scalar::interleavedToPlanar(floats.data(), 4, refPlanes, pixels); },
+           [&] { bud::interleavedToPlanar(floats.data(), 4, floatPlanes, pixels); },
+           [&] { threaded(pixels, [&](size_t i, size_t n) {
+               float* planes[4] = { floatPlanes[0] + i, floatPlanes[1] + i, floatPlanes[2] + i, floatPlanes[3] + i };
+               bud::interleavedToPlanar(floats.data() + 4 * i, 4, planes, n);
+           }); },
+           floatOut == floatRef);
+
+    report("f32 -> f16", elements * 6,
+           [&] { bud::scalar::f32ToF16(floats.data(), halfRef.data(), elements); },
+           [&] { bud::f32ToF16(floats.data(), halfOut.data(), elements); },
+           [&] { threaded(elements, [&](size_t i, size_t n) { bud::f32ToF16(floats.data() + i, halfOut.data() + i, n); }); },
+           std::memcmp(halfOut.data(), halfRef.data(), elements * sizeof(bud::half)) == 0);
+
+    report("f16 -> f32", elements * 6,
+           [&] { bud::scalar::f16ToF32(halves.data(), floatRef.data(), elements); },
+           [&] { bud::f16ToF32(halves.data(), floatOut.data(), elements); },
+           [&] { threaded(elements, [&](size_t i, size_t n) { bud::f16ToF32(halves.data() + i, floatOut.data() + i, n); }); },
+           floatOut == floatRef);
+
+    // an RGB8 frame to half staging: importPixels() into the frame then copyRect(), against the one pass of importRect()
+    // that Image::importPixels() defers to the upload; both also keep the float frame and its diff base
+    const int width = 1920;
+    const bud::Rect frame{ 0, 0, width, static_cast<int>(pixels / width) };
+    bud::PixelBuffer<float> image(elements), previous(elements);
+    bud::PixelImport import;
+    import.layout = bud::PixelLayout::RGB8;
+    import.src = rgb.data();
+    const size_t importBytes = pixels * 3 + elements * (2 * sizeof(float) + sizeof(bud::half));
+    const double twoPass = throughput(importBytes, [&] {
+        bud::importPixels(import.layout, import.src, nullptr, image.data(), pixels);
+        std::memcpy(previous.data(), image.data(), elements * sizeof(float));
+        bud::copyRect<bud::half>(image, width, 4, frame, halfRef.data(), width * 4 * sizeof(bud::half));
+    });
+    const double fused = throughput(importBytes, [&] {
+        bud::importRect<bud::half>(import, width, frame, image.data(), previous.data(), halfOut.data(), width * 4 * sizeof(bud::half));
+    });
+    std::printf("%-22s two passes %6.2f GB/s, fused %6.2f GB/s%s\n", "RGB8 import -> f16", twoPass, fused,
+                std::memcmp(halfOut.data(), halfRef.data(), elements * sizeof(bud::half)) == 0 ? "" : "  MISMATCH");
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <budOpenCL.hpp>
+#include <budOpenGL.hpp>
+#include <budVulkan.hpp>
+#include <budDaemon.hpp>
+
+// Linux only. ./budDaemon [socket] serves, ./budDaemon --client [socket] sends a few frames to every backend.
+// With PoCL and lavapipe as the OpenCL and Vulkan drivers the whole path runs without a GPU.
+
+namespace {
+
+const char* const defaultSocket = "/tmp/bud-daemon.sock";
+
+bud::ipc::Daemon* daemonInstance = nullptr;
+
+void stopDaemon(int)
+{
+    if (daemonInstance) daemonInstance->stop();
+}
+
+std::unique_ptr<bud::Imagef> makeImage(const bud::ipc::Job& job)
+{
+    switch (job.backend) {
+    case bud::Backend::OpenCL:
+        return std::make_unique<bud::cl::ImageCL>(job.width, job.height, job.nrChannels, job.resize);
+    case bud::Backend::OpenGL:
+        return std::make_unique<bud::gl::ImageGL>(job.width, job.height, job.nrChannels, job.resize);
+    case bud::Backend::Vulkan:
+        return std::make_unique<bud::vk::ImageVK>(job.width, job.height, job.nrChannels, job.resize);
+    }
+    return nullptr;
+}
+
+// the second frame of each backend reuses the daemon's device objects and only uploads the changed tile
+void runClient(const std::string& socketPath)
+{
+    bud::ipc::Client client(socketPath);
+    const bud::Backend backends[] = { bud::Backend::OpenCL, bud::Backend::OpenGL, bud::Backend::Vulkan };
+    const char* const names[] = { "OpenCL", "OpenGL", "Vulkan" };
+
+    for (int frame = 0; frame < 2; ++frame) {
+        for (int i = 0; i < 3; ++i) {
+            bud::ipc::Job job;
+            job.backend = backends[i];
+            job.width = 64;
+            job.height = 64;
+            job.resize = bud::Resize{ 32, 32, bud::Filter::Lanczos, bud::Format::RGBA8 };
+
+            auto start = std::chrono::steady_clock::now();
+            float* pixels = client.acquire();
+            const size_t count = static_cast<size_t>(job.width) * job.height * job.nrChannels;
+            for (size_t p = 0; p < count; ++p) pixels[p] = static_cast<float>(p * 7 % 128);
+            if (frame) pixels[0] += 1.0f;
+            client.submit(job);
+            size_t outputBytes = 0;
+            client.wait(&outputBytes);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("%s frame %d: %zu bytes in %.3f ms\n", names[i], frame, outputBytes, elapsed.count());
+        }
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const bool client = argc > 1 && std::string(argv[1]) == "--client";
+    const int socketArg = client ? 2 : 1;
+    const std::string socketPath = argc > socketArg ? argv[socketArg] : defaultSocket;
+
+    try {
+        if (client) {
+            runClient(socketPath);
+            return 0;
+        }
+
+        bud::ipc::Daemon daemon(socketPath, makeImage);
+        daemonInstance = &daemon;
+        std::signal(SIGINT, stopDaemon);
+        std::signal(SIGTERM, stopDaemon);
+        daemon.run();
+        daemonInstance = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -1,26 +1,74 @@
-#include <vector>
-#include <iostream>
-#include <stdexcept>
-#include <budImage.hpp>
-#include <budOpenCL.hpp>
-#include <budOpenGL.hpp>
-#include <budVulkan.hpp>
-
-int main()
-{
-    std::vector<bud::Imagef*> images;
-
-    bud::cl::ImageCL imageCL(8, 8, 4);
-    bud::gl::ImageGL imageGL(8, 8, 4);
-    bud::vk::ImageVK imageVK(8, 8, 4);
-
-    images.push_back(static_cast<bud::Imagef*>(&imageCL));
-    images.push_back(static_cast<bud::Imagef*>(&imageGL));
-    images.push_back(static_cast<bud::Imagef*>(&imageVK));
-
-    try {
-        for (const auto image : images) image->compute();
-    } catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
-    }
-}
+#include <vector>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <budImage.hpp>
+#include <budOpenCL.hpp>
+#include <budOpenGL.hpp>
+#include <budVulkan.hpp>
+#include <budMetrics.hpp>
+
+int main()
+{
+    std::vector<bud::Imagef*> images;
+
+    bud::cl::ImageCL imageCL(8, 8, 4);
+    bud::gl::ImageGL imageGL(8, 8, 4);
+    bud::vk::ImageVK imageVK(8, 8, 4);
+
+    images.push_back(static_cast<bud::Imagef*>(&imageCL));
+    images.push_back(static_cast<bud::Imagef*>(&imageGL));
+    images.push_back(static_cast<bud::Imagef*>(&imageVK));
+
+    const bud::Resize resize{ 5, 3, bud::Filter::Lanczos, bud::Format::RGBA8 };
+    bud::cl::ImageCL resizeCL(8, 8, 4, resize);
+    bud::gl::ImageGL resizeGL(8, 8, 4, resize);
+    bud::vk::ImageVK resizeVK(8, 8, 4, resize);
+
+    images.push_back(static_cast<bud::Imagef*>(&resizeCL));
+    images.push_back(static_cast<bud::Imagef*>(&resizeGL));
+    images.push_back(static_cast<bud::Imagef*>(&resizeVK));
+
+    // the half configuration gives the device format and the readback tolerance
+    using HalfTraits = bud::ImageTraits<bud::half, 4, bud::Layout::Interleaved>;
+    const bud::Resize halfResize{ 16, 16, bud::Filter::Bicubic };
+    auto halfCL = bud::makeDeviceImage<bud::cl::ImageCL, HalfTraits>(8, 8, halfResize);
+    auto halfGL = bud::makeDeviceImage<bud::gl::ImageGL, HalfTraits>(8, 8, halfResize);
+    auto halfVK = bud::makeDeviceImage<bud::vk::ImageVK, HalfTraits>(8, 8, halfResize);
+
+    images.push_back(static_cast<bud::Imagef*>(halfCL.get()));
+    images.push_back(static_cast<bud::Imagef*>(halfGL.get()));
+    images.push_back(static_cast<bud::Imagef*>(halfVK.get()));
+
+    bud::Metrics::instance().enableTrace(true);
+    try {
+        // the host path: a planar image holds the same pixels as the interleaved one and must resize them the same
+        bud::Image<float, 4> interleaved(8, 8, resize);
+        bud::Image<float, 4, bud::Layout::Planar> planar(8, 8, resize);
+        interleaved.compute();
+        planar.compute();
+        bud::checkErrorCode<bool, true>(planar.m_result == interleaved.m_result, "failed to match the planar and interleaved resize!");
+        bud::checkErrorCode<bool, true>(planar.validateImageData(interleaved.m_result), "failed to validate the planar resize!");
+
+        for (const auto image : images) image->compute();
+
+        // the next frame only uploads and recomputes the tiles around the changed pixel
+        for (const auto image : images) {
+            image->m_data[0] += 1.0f;
+            image->compute();
+        }
+
+        // one frame of every image in flight at once, read back and validated by the completion thread
+        std::vector<std::future<void>> frames;
+        for (const auto image : images) {
+            image->m_data[1] += 1.0f;
+            frames.push_back(image->computeAsync());
+        }
+        for (auto& frame : frames) frame.get();
+
+        bud::Metrics::instance().writePrometheus("bud.prom");
+        bud::Metrics::instance().writeTrace("bud.trace.json");
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <budImage.hpp>
+#include <budPool.hpp>
+
+// Host-only: g++ -std=c++17 -O2 -I. poolBenchmark.cpp -o poolBenchmark
+
+namespace {
+
+// the host side of a compute(): pixel data, a full-size readback scratch and validation
+class ImageHost final : public bud::Imagef {
+public:
+    explicit ImageHost(const int width, const int height, const int nrChannels)
+        : Imagef(width, height, nrChannels) {}
+
+    void compute() override
+    {
+        bud::PixelBuffer<float> got(m_data.begin(), m_data.end());
+        bool valid = validateImageData(got);
+        bud::checkErrorCode<bool, true>(valid, "failed to validate image data!");
+    }
+};
+
+template<typename Buffer>
+double touchFrames(const size_t elements, const int frames)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        Buffer data(elements);
+        Buffer got(elements);
+        for (size_t i = 0; i < elements; i += 1024) got[i] = data[i] + 1.0f;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+}
+
+int main()
+{
+    constexpr int width = 640;
+    constexpr int height = 480;
+    constexpr int nrChannels = 4;
+    constexpr int warmupFrames = 2;
+    constexpr int frames = 10;
+
+    for (int frame = 0; frame < warmupFrames; ++frame) ImageHost(width, height, nrChannels).compute();
+
+    const bud::PoolStats before = bud::PixelPool::instance().stats();
+    for (int frame = 0; frame < frames; ++frame) ImageHost(width, height, nrChannels).compute();
+    const bud::PoolStats after = bud::PixelPool::instance().stats();
+
+    std::printf("steady state: %.2f allocations/frame, hit rate %.1f%%, mapped %.1f MiB\n",
+                static_cast<double>(after.misses - before.misses) / frames, after.hitRate() * 100.0,
+                after.mappedBytes / (1024.0 * 1024.0));
+
+    const size_t elements = static_cast<size_t>(width) * height * nrChannels;
+    const double heap = touchFrames<std::vector<float>>(elements, frames);
+    const double pool = touchFrames<bud::PixelBuffer<float>>(elements, frames);
+    std::printf("allocate + touch per frame: std::vector %.3f ms, PixelBuffer %.3f ms\n", heap, pool);
+}
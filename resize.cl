@@ -0,0 +1,99 @@
+#ifndef FILTER
+#define FILTER 2
+#endif
+#ifndef OUTPUT_SCALE
+#define OUTPUT_SCALE 1.0f
+#endif
+
+// USE_HALF accumulates in half on devices with cl_khr_fp16, storage precision is set by the image formats
+#ifdef USE_HALF
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+typedef half4 pixel_t;
+typedef half scalar_t;
+#define read_pixel read_imageh
+#else
+typedef float4 pixel_t;
+typedef float scalar_t;
+#define read_pixel read_imagef
+#endif
+
+#define FILTER_NEAREST 1
+#define FILTER_BILINEAR 2
+#define FILTER_BICUBIC 3
+#define FILTER_LANCZOS 4
+#define FILTER_TRIANGLE 5
+
+__constant sampler_t nearestSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+__constant sampler_t linearSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+
+float filterWeight(float x)
+{
+    x = fabs(x);
+#if FILTER == FILTER_TRIANGLE
+    return max(1.0f - x, 0.0f);
+#elif FILTER == FILTER_BICUBIC
+    const float a = -0.5f;
+    if (x < 1.0f) return ((a + 2.0f) * x - (a + 3.0f)) * x * x + 1.0f;
+    if (x < 2.0f) return ((a * x - 5.0f * a) * x + 8.0f * a) * x - 4.0f * a;
+    return 0.0f;
+#else
+    if (x < 1e-6f) return 1.0f;
+    if (x >= 3.0f) return 0.0f;
+    float px = M_PI_F * x;
+    return 3.0f * sin(px) * sin(px / 3.0f) / (px * px);
+#endif
+}
+
+float4 resample(__read_only image2d_t src, int2 pos, int horizontal, int srcLength, int dstLength)
+{
+    const float radius = FILTER == FILTER_TRIANGLE ? 1.0f : FILTER == FILTER_BICUBIC ? 2.0f : 3.0f;
+    float scale = (float)srcLength / (float)dstLength;
+    float filterScale = max(scale, 1.0f);
+    float support = radius * filterScale;
+    float center = ((float)(horizontal ? pos.x : pos.y) + 0.5f) * scale;
+
+    pixel_t sum = (pixel_t)(0.0f);
+    float weightSum = 0.0f;
+    int last = (int)ceil(center + support);
+    for (int i = (int)floor(center - support); i <= last; ++i) {
+        float weight = filterWeight(((float)i + 0.5f - center) / filterScale);
+        int s = clamp(i, 0, srcLength - 1);
+        sum += (scalar_t)weight * read_pixel(src, nearestSampler, horizontal ? (int2)(s, pos.y) : (int2)(pos.x, s));
+        weightSum += weight;
+    }
+    return convert_float4(sum) / weightSum;
+}
+
+__kernel void resize(__read_only image2d_t src, __write_only image2d_t dst)
+{
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+    int2 srcSize = get_image_dim(src);
+    int2 dstSize = get_image_dim(dst);
+    if (pos.x >= dstSize.x || pos.y >= dstSize.y) return;
+
+#if FILTER == FILTER_NEAREST
+    int2 coord = min((2 * pos + 1) * srcSize / (2 * dstSize), srcSize - 1);
+    float4 pixel = read_imagef(src, nearestSampler, coord);
+#else
+    float4 pixel = read_imagef(src, linearSampler, (convert_float2(pos) + 0.5f) / convert_float2(dstSize));
+#endif
+    write_imagef(dst, pos, pixel * OUTPUT_SCALE);
+}
+
+__kernel void resizeHorizontal(__read_only image2d_t src, __write_only image2d_t dst)
+{
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+    int2 dstSize = get_image_dim(dst);
+    if (pos.x >= dstSize.x || pos.y >= dstSize.y) return;
+
+    write_imagef(dst, pos, resample(src, pos, 1, get_image_width(src), dstSize.x));
+}
+
+__kernel void resizeVertical(__read_only image2d_t src, __write_only image2d_t dst)
+{
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+    int2 dstSize = get_image_dim(dst);
+    if (pos.x >= dstSize.x || pos.y >= dstSize.y) return;
+
+    write_imagef(dst, pos, resample(src, pos, 0, get_image_height(src), dstSize.y) * OUTPUT_SCALE);
+}